@@ -0,0 +1,47 @@
+#!/bin/bash
+
+level="-L3"
+
+echo -e "\033[1mChecking script for concurrent detection"
+echo "Author: Jan Neuzil"
+echo -e "neuzija1@fit.cvut.cz\033[0m\n"
+
+if [ $# -ne 1 ]; then
+    echo -e "\033[1;31mError:  \033[0mBad arguments, usage: $0 DATA_FILE."
+	exit 1
+fi
+
+if [ -n "$(ls -A res 2>/dev/null | grep -v .gitkeep)" ]; then
+	echo -e "\033[1;31mError:  \033[0mDirectory res is not empty, move previous results away first."
+	exit 1
+fi
+
+if ! [ -f $PWD/ddos_detection ]; then
+	echo -e "\033[1mInfo:  \033[0mCompiling DDoS detection program."
+	make > /dev/null
+fi
+
+if ! [ -f $PWD/ddos_detection ]; then
+	echo -e "\033[1;31mError:  \033[0mBinary file of the DDoS detection program is missing, compilation failed."
+	exit 1
+fi
+
+tmp=$(mktemp -d)
+mkdir $tmp/sequential $tmp/concurrent
+
+echo -e "\033[1mInfo: \033[0mRunning DDoS detection sequentially."
+./ddos_detection -d7 $level -f $1 > /dev/null 2>&1
+mv res/* $tmp/sequential/ 2>/dev/null
+
+echo -e "\033[1mInfo: \033[0mRunning DDoS detection concurrently with ingestion."
+./ddos_detection -d7 $level -c -f $1 > /dev/null 2>&1
+mv res/* $tmp/concurrent/ 2>/dev/null
+
+if ! diff -r $tmp/sequential $tmp/concurrent > /dev/null; then
+	echo -e "\033[1;31mError:  \033[0mResults of concurrent detection differ, kept in $tmp."
+	exit 1
+fi
+
+echo -e "\033[1mInfo: \033[0mResults of concurrent detection are identical."
+rm -rf $tmp
+exit 0
@@ -0,0 +1,387 @@
+/*!
+ * \file archive.c
+ * \brief Columnar flow archive library.
+ * \author Jan Neuzil <neuzija1@fit.cvut.cz>
+ * \date 2014
+ */
+/*
+ * Copyright (C) 2014 ISEP
+ */
+
+#include "archive.h"
+
+void archive_header(archive_header_t *header)
+{
+   archive_column_t columns[ARCHIVE_COLUMNS] = {
+      {FIELD_TIME_FIRST, CODEC_DELTA, 0},
+      {FIELD_DST_IP, CODEC_DELTA, 0},
+      {FIELD_DST_PORT, CODEC_VARINT, 0},
+      {FIELD_PACKETS, CODEC_VARINT, 0},
+      {FIELD_SYN_FLAG, CODEC_VARINT, 0},
+      {FIELD_TIME_LAST, CODEC_DELTA, 0},
+      {FIELD_SRC_IP, CODEC_DELTA, 0},
+      {FIELD_SRC_PORT, CODEC_VARINT, 0},
+      {FIELD_PROTOCOL, CODEC_VARINT, 0},
+      {FIELD_BYTES, CODEC_VARINT, 0}
+   };
+
+   memset(header, 0, sizeof(archive_header_t));
+   memcpy(header->magic, ARCHIVE_MAGIC, ARCHIVE_MAGIC_LEN);
+   header->version = ARCHIVE_VERSION;
+   header->columns_cnt = ARCHIVE_COLUMNS;
+   header->byte_order = ARCHIVE_ORDER;
+   header->block_size = ARCHIVE_BLOCK;
+   header->partition = ARCHIVE_PARTITION;
+   header->time_first = UINT64_MAX;
+   header->time_last = 0;
+   memcpy(header->columns, columns, sizeof(columns));
+}
+
+uint32_t archive_fields(int mode)
+{
+   uint32_t mask;
+
+   // All columns are needed for the conversion.
+   if (mode == 0) {
+      return (1 << FIELDS) - 1;
+   }
+
+   // Fields needed to find the host and its interval.
+   mask = (1 << FIELD_DST_IP) | (1 << FIELD_TIME_FIRST) | (1 << FIELD_SYN_FLAG);
+   if ((mode & SYN_FLOODING) == SYN_FLOODING) {
+      mask |= (1 << FIELD_TIME_LAST) | (1 << FIELD_PACKETS);
+   }
+   if (((mode & VER_PORTSCAN) == VER_PORTSCAN) || ((mode & HOR_PORTSCAN) == HOR_PORTSCAN)) {
+      mask |= (1 << FIELD_DST_PORT);
+   }
+   return mask;
+}
+
+uint64_t archive_value(const flow_t *flow, int field)
+{
+   switch (field) {
+      case FIELD_DST_IP:
+         return ntohl(flow->dst_ip);
+      case FIELD_SRC_IP:
+         return ntohl(flow->src_ip);
+      case FIELD_DST_PORT:
+         return flow->dst_port;
+      case FIELD_SRC_PORT:
+         return flow->src_port;
+      case FIELD_PROTOCOL:
+         return flow->protocol;
+      case FIELD_TIME_FIRST:
+         return flow->time_first;
+      case FIELD_TIME_LAST:
+         return flow->time_last;
+      case FIELD_BYTES:
+         return flow->bytes;
+      case FIELD_PACKETS:
+         return flow->packets;
+      case FIELD_SYN_FLAG:
+         return flow->syn_flag;
+      default:
+         return 0;
+   }
+}
+
+void archive_store(flow_t *flow, int field, uint64_t value)
+{
+   switch (field) {
+      case FIELD_DST_IP:
+         flow->dst_ip = htonl(value);
+         break;
+      case FIELD_SRC_IP:
+         flow->src_ip = htonl(value);
+         break;
+      case FIELD_DST_PORT:
+         flow->dst_port = value;
+         break;
+      case FIELD_SRC_PORT:
+         flow->src_port = value;
+         break;
+      case FIELD_PROTOCOL:
+         flow->protocol = value;
+         break;
+      case FIELD_TIME_FIRST:
+         flow->time_first = value;
+         break;
+      case FIELD_TIME_LAST:
+         flow->time_last = value;
+         break;
+      case FIELD_BYTES:
+         flow->bytes = value;
+         break;
+      case FIELD_PACKETS:
+         flow->packets = value;
+         break;
+      case FIELD_SYN_FLAG:
+         flow->syn_flag = value;
+         break;
+   }
+}
+
+uint32_t archive_encode(uint8_t *buffer, const flow_t *flows, uint32_t cnt, const archive_column_t *column)
+{
+   uint32_t i, len;
+   uint64_t prev, value, x;
+
+   len = 0;
+   prev = 0;
+   for (i = 0; i < cnt; i ++) {
+      value = archive_value(&(flows[i]), column->field);
+      x = value;
+
+      // Storing zigzag encoded difference to the previous value.
+      if (column->codec == CODEC_DELTA) {
+         x = value - prev;
+         x = (x << 1) ^ (0 - (x >> 63));
+         prev = value;
+      }
+
+      // Storing 7 bits in every byte, the highest bit marks continuation.
+      while (x >= 0x80) {
+         buffer[len ++] = (x & 0x7F) | 0x80;
+         x >>= 7;
+      }
+      buffer[len ++] = x;
+   }
+   return len;
+}
+
+int archive_decode(flow_t *flows, uint32_t cnt, const uint8_t *data, uint32_t size, const archive_column_t *column)
+{
+   int shift;
+   uint32_t i, len;
+   uint64_t prev, x;
+
+   len = 0;
+   prev = 0;
+   for (i = 0; i < cnt; i ++) {
+      x = 0;
+      shift = 0;
+      do {
+         if (len == size || shift > 63) {
+            fprintf(stderr, "%sCorrupted column in flow archive.\n", ERROR);
+            return EXIT_FAILURE;
+         }
+         x |= ((uint64_t) (data[len] & 0x7F)) << shift;
+         shift += 7;
+      } while (data[len ++] & 0x80);
+
+      if (column->codec == CODEC_DELTA) {
+         x = (x >> 1) ^ (0 - (x & 1));
+         x += prev;
+         prev = x;
+      }
+      archive_store(&(flows[i]), column->field, x);
+   }
+   return EXIT_SUCCESS;
+}
+
+int archive_check(const char *data, size_t size)
+{
+   int i;
+   uint64_t j, offset;
+   const archive_header_t *header;
+   const archive_block_t *blocks;
+
+   header = (const archive_header_t *) data;
+   if (size < sizeof(archive_header_t) || memcmp(header->magic, ARCHIVE_MAGIC, ARCHIVE_MAGIC_LEN) != 0) {
+      fprintf(stderr, "%sGiven file is not a flow archive file.\n", ERROR);
+      return EXIT_FAILURE;
+   }
+   if (header->byte_order != ARCHIVE_ORDER) {
+      fprintf(stderr, "%sFlow archive file has different byte order.\n", ERROR);
+      return EXIT_FAILURE;
+   }
+   if (header->version != ARCHIVE_VERSION || header->columns_cnt != ARCHIVE_COLUMNS) {
+      fprintf(stderr, "%sUnsupported version %u of flow archive file.\n", ERROR, header->version);
+      return EXIT_FAILURE;
+   }
+   for (i = 0; i < ARCHIVE_COLUMNS; i ++) {
+      if (header->columns[i].field >= FIELDS || (header->columns[i].codec != CODEC_VARINT && header->columns[i].codec != CODEC_DELTA)) {
+         fprintf(stderr, "%sUnsupported column of flow archive file.\n", ERROR);
+         return EXIT_FAILURE;
+      }
+   }
+
+   // Checking the block index and all columns lie within the file.
+   if (header->index_offset < sizeof(archive_header_t) || header->index_offset > size ||
+       header->blocks_cnt > (size - header->index_offset) / sizeof(archive_block_t)) {
+      fprintf(stderr, "%sFlow archive file is truncated or not properly closed.\n", ERROR);
+      return EXIT_FAILURE;
+   }
+   blocks = (const archive_block_t *) (data + header->index_offset);
+   for (j = 0; j < header->blocks_cnt; j ++) {
+      offset = blocks[j].offset;
+      for (i = 0; i < ARCHIVE_COLUMNS; i ++) {
+         offset += blocks[j].sizes[i];
+      }
+      if (blocks[j].offset < sizeof(archive_header_t) || offset > header->index_offset || blocks[j].records_cnt > header->block_size) {
+         fprintf(stderr, "%sCorrupted block index of flow archive file.\n", ERROR);
+         return EXIT_FAILURE;
+      }
+   }
+   return EXIT_SUCCESS;
+}
+
+archive_t *create_archive(const char *path)
+{
+   archive_t *archive;
+
+   archive = (archive_t *) calloc(1, sizeof(archive_t));
+   if (archive == NULL) {
+      fprintf(stderr, "%sNot enough memory for archive structure.\n", ERROR);
+      return NULL;
+   }
+   archive_header(&(archive->header));
+   archive->blocks_max = BLOCKS_INIT;
+
+   archive->flows = (flow_t *) calloc(ARCHIVE_BLOCK, sizeof(flow_t));
+   archive->buffer = (uint8_t *) calloc(ARCHIVE_BLOCK, ARCHIVE_VARINT);
+   archive->blocks = (archive_block_t *) calloc(archive->blocks_max, sizeof(archive_block_t));
+   if (archive->flows == NULL || archive->buffer == NULL || archive->blocks == NULL) {
+      fprintf(stderr, "%sNot enough memory for archive structure.\n", ERROR);
+      goto error;
+   }
+
+   archive->file = fopen(path, "wb");
+   if (archive->file == NULL) {
+      fprintf(stderr, "%sCannot create given archive file.\n", ERROR);
+      goto error;
+   }
+
+   // Writing empty header to be rewritten when the file is closed.
+   if (fwrite(&(archive->header), sizeof(archive_header_t), 1, archive->file) != 1) {
+      fprintf(stderr, "%sCannot write header of archive file.\n", ERROR);
+      goto error;
+   }
+   archive->offset = sizeof(archive_header_t);
+   return archive;
+
+   // Cleaning up after error.
+   error:
+      if (archive->file != NULL) {
+         fclose(archive->file);
+      }
+      free(archive->flows);
+      free(archive->buffer);
+      free(archive->blocks);
+      free(archive);
+      return NULL;
+}
+
+int flush_archive(archive_t *archive)
+{
+   int i;
+   uint32_t j, len;
+   archive_block_t *block;
+
+   if (archive->flows_cnt == 0) {
+      return EXIT_SUCCESS;
+   }
+
+   // Reallocating block index if needed.
+   if (archive->header.blocks_cnt == archive->blocks_max) {
+      archive->blocks_max *= 2;
+      block = (archive_block_t *) realloc(archive->blocks, archive->blocks_max * sizeof(archive_block_t));
+      if (block == NULL) {
+         fprintf(stderr, "%sNot enough memory for block index.\n", ERROR);
+         return EXIT_FAILURE;
+      }
+      archive->blocks = block;
+   }
+
+   block = &(archive->blocks[archive->header.blocks_cnt]);
+   memset(block, 0, sizeof(archive_block_t));
+   block->offset = archive->offset;
+   block->records_cnt = archive->flows_cnt;
+   block->time_first = UINT64_MAX;
+   for (j = 0; j < archive->flows_cnt; j ++) {
+      if (archive->flows[j].time_first < block->time_first) {
+         block->time_first = archive->flows[j].time_first;
+      }
+      if (archive->flows[j].time_first > block->time_last) {
+         block->time_last = archive->flows[j].time_first;
+      }
+   }
+
+   // Compressing and writing every column separately.
+   for (i = 0; i < ARCHIVE_COLUMNS; i ++) {
+      len = archive_encode(archive->buffer, archive->flows, archive->flows_cnt, &(archive->header.columns[i]));
+      if (fwrite(archive->buffer, 1, len, archive->file) != len) {
+         fprintf(stderr, "%sCannot write column into archive file.\n", ERROR);
+         return EXIT_FAILURE;
+      }
+      block->sizes[i] = len;
+      archive->offset += len;
+   }
+
+   // Updating the time range of the archive.
+   if (block->time_first < archive->header.time_first) {
+      archive->header.time_first = block->time_first;
+   }
+   if (block->time_last > archive->header.time_last) {
+      archive->header.time_last = block->time_last;
+   }
+   archive->header.records_cnt += archive->flows_cnt;
+   archive->header.blocks_cnt ++;
+   archive->flows_cnt = 0;
+   return EXIT_SUCCESS;
+}
+
+int write_archive(archive_t *archive, const flow_t *flow)
+{
+   // Starting a new block if the current is full or in another time partition.
+   if (archive->flows_cnt == ARCHIVE_BLOCK ||
+       (archive->flows_cnt > 0 && flow->time_first / ARCHIVE_PARTITION != archive->flows[0].time_first / ARCHIVE_PARTITION)) {
+      if (flush_archive(archive) != EXIT_SUCCESS) {
+         return EXIT_FAILURE;
+      }
+   }
+
+   archive->flows[archive->flows_cnt ++] = *flow;
+   return EXIT_SUCCESS;
+}
+
+int free_archive(archive_t *archive)
+{
+   int ret;
+   uint64_t padding;
+
+   ret = flush_archive(archive);
+
+   // Aligning the block index to be read directly from the mapped file.
+   padding = (sizeof(uint64_t) - archive->offset % sizeof(uint64_t)) % sizeof(uint64_t);
+   if (ret == EXIT_SUCCESS && padding > 0) {
+      memset(archive->buffer, 0, padding);
+      if (fwrite(archive->buffer, 1, padding, archive->file) != padding) {
+         fprintf(stderr, "%sCannot write block index of archive file.\n", ERROR);
+         ret = EXIT_FAILURE;
+      }
+      archive->offset += padding;
+   }
+
+   // Writing block index and final header.
+   if (ret == EXIT_SUCCESS) {
+      archive->header.index_offset = archive->offset;
+      if (archive->header.blocks_cnt == 0) {
+         archive->header.time_first = 0;
+      }
+      if (fwrite(archive->blocks, sizeof(archive_block_t), archive->header.blocks_cnt, archive->file) != archive->header.blocks_cnt ||
+          fseek(archive->file, 0, SEEK_SET) != 0 || fwrite(&(archive->header), sizeof(archive_header_t), 1, archive->file) != 1) {
+         fprintf(stderr, "%sCannot write block index of archive file.\n", ERROR);
+         ret = EXIT_FAILURE;
+      }
+   }
+   if (fclose(archive->file) != 0) {
+      fprintf(stderr, "%sCannot close archive file.\n", ERROR);
+      ret = EXIT_FAILURE;
+   }
+   free(archive->flows);
+   free(archive->buffer);
+   free(archive->blocks);
+   free(archive);
+   return ret;
+}
@@ -0,0 +1,203 @@
+/*!
+ * \file archive.h
+ * \brief Header file to columnar flow archive library.
+ * \author Jan Neuzil <neuzija1@fit.cvut.cz>
+ * \date 2014
+ */
+/*
+ * Copyright (C) 2014 ISEP
+ */
+
+#ifndef _ARCHIVE_
+#define _ARCHIVE_
+
+#include "main.h"
+
+/*!
+ * \name Archive format values.
+ * Defines macros used by columnar flow archive file.
+ * \{ */
+#define ARCHIVE_MAGIC "DDOSARCH" /*!< Magic string at the beginning of an archive file. */
+#define ARCHIVE_MAGIC_LEN 8 /*!< Length of the magic string. */
+#define ARCHIVE_VERSION 1 /*!< Version of the archive format. */
+#define ARCHIVE_ORDER 0x01020304 /*!< Byte order mark of the archive file. */
+#define ARCHIVE_BLOCK 65536 /*!< Maximum number of flow records in a block. */
+#define ARCHIVE_PARTITION 3600 /*!< Time partition in seconds, a block never crosses its boundary. */
+#define ARCHIVE_COLUMNS 10 /*!< Number of columns, all flow fields except the unknown one. */
+#define ARCHIVE_VARINT 10 /*!< Maximum length of an encoded value in bytes. */
+#define BLOCKS_INIT 64 /*!< Init size of array with block descriptors. */
+/*! \} */
+
+/*!
+ * \brief Column codec enumeration.
+ * Compression method used for values of a column.
+ */
+enum column_codec {
+   CODEC_VARINT = 1, /*!< Variable length encoding of unsigned values. */
+   CODEC_DELTA = 2 /*!< Variable length encoding of zigzag differences to the previous value. */
+};
+
+/*!
+ * \brief Column descriptor structure.
+ * Structure describing which flow field is stored in a column and how.
+ */
+typedef struct archive_column {
+   uint8_t field; /*!< Field identifier from flow field enumeration. */
+   uint8_t codec; /*!< Compression method of the column. */
+   uint16_t reserved; /*!< Reserved for future use. */
+} archive_column_t;
+
+/*!
+ * \brief Archive header structure.
+ * Header at the beginning of archive file describing columns, time range
+ * and position of block index at the end of the file.
+ */
+typedef struct archive_header {
+   char magic[ARCHIVE_MAGIC_LEN]; /*!< Magic string to identify archive file. */
+   uint16_t version; /*!< Version of the archive format. */
+   uint16_t columns_cnt; /*!< Number of columns in every block. */
+   uint32_t byte_order; /*!< Byte order mark to detect different endianness. */
+   uint32_t block_size; /*!< Maximum number of flow records in a block. */
+   uint32_t partition; /*!< Time partition of blocks in seconds. */
+   uint64_t blocks_cnt; /*!< Number of blocks in the archive. */
+   uint64_t records_cnt; /*!< Number of flow records in the archive. */
+   uint64_t time_first; /*!< The lowest timestamp of the first packet. */
+   uint64_t time_last; /*!< The highest timestamp of the first packet. */
+   uint64_t index_offset; /*!< Offset of the block index in the file. */
+   archive_column_t columns[ARCHIVE_COLUMNS]; /*!< Descriptors of stored columns. */
+} archive_header_t;
+
+/*!
+ * \brief Block descriptor structure.
+ * Entry of the block index with time range of the block and compressed
+ * sizes of its columns stored one after another.
+ */
+typedef struct archive_block {
+   uint64_t offset; /*!< Offset of the first column of the block in the file. */
+   uint64_t time_first; /*!< The lowest timestamp of the first packet in the block. */
+   uint64_t time_last; /*!< The highest timestamp of the first packet in the block. */
+   uint32_t records_cnt; /*!< Number of flow records in the block. */
+   uint32_t sizes[ARCHIVE_COLUMNS]; /*!< Compressed sizes of the columns. */
+} archive_block_t;
+
+/*!
+ * \brief Archive structure.
+ * Structure of opened archive file being written, with the current block
+ * of flow records and the index of all written blocks.
+ */
+typedef struct archive {
+   FILE *file; /*!< Opened archive file. */
+   uint64_t offset; /*!< Current offset in the file. */
+   uint32_t flows_cnt; /*!< Number of flow records in the current block. */
+   flow_t *flows; /*!< Flow records of the current block. */
+   uint8_t *buffer; /*!< Buffer for a compressed column. */
+   uint64_t blocks_max; /*!< Maximum number of blocks in the index. */
+   archive_block_t *blocks; /*!< Index of written blocks. */
+   archive_header_t header; /*!< Header to be written when the file is closed. */
+} archive_t;
+
+/*!
+ * \brief Header initialization.
+ * Function to initialize header of an empty archive with the current columns.
+ * \param[out] header Pointer to header structure.
+ */
+void archive_header(archive_header_t *header);
+
+/*!
+ * \brief Column selection function.
+ * Function to determine which columns are needed by given detection mode.
+ * \param[in] mode Detection mode, 0 for all columns.
+ * \return Mask of needed fields, bit position is the field identifier.
+ */
+uint32_t archive_fields(int mode);
+
+/*!
+ * \brief Field getter.
+ * Function to get value of given field of flow record as unsigned number,
+ * IP addresses are returned in host byte order.
+ * \param[in] flow Pointer to flow record structure.
+ * \param[in] field Field identifier.
+ * \return Value of the field.
+ */
+uint64_t archive_value(const flow_t *flow, int field);
+
+/*!
+ * \brief Field setter.
+ * Function to set given field of flow record from unsigned number,
+ * IP addresses are expected in host byte order.
+ * \param[out] flow Pointer to flow record structure.
+ * \param[in] field Field identifier.
+ * \param[in] value Value of the field.
+ */
+void archive_store(flow_t *flow, int field, uint64_t value);
+
+/*!
+ * \brief Encoding function.
+ * Function to compress a column of flow records into a buffer.
+ * \param[out] buffer Buffer of at least ARCHIVE_VARINT bytes for every record.
+ * \param[in] flows Array of flow records.
+ * \param[in] cnt Number of flow records.
+ * \param[in] column Descriptor of the column.
+ * \return Number of bytes written to the buffer.
+ */
+uint32_t archive_encode(uint8_t *buffer, const flow_t *flows, uint32_t cnt, const archive_column_t *column);
+
+/*!
+ * \brief Decoding function.
+ * Function to decompress a column into given field of flow records.
+ * \param[out] flows Array of flow records.
+ * \param[in] cnt Number of flow records.
+ * \param[in] data Compressed column.
+ * \param[in] size Size of the compressed column in bytes.
+ * \param[in] column Descriptor of the column.
+ * \return EXIT_SUCCESS on success, otherwise EXIT_FAILURE.
+ */
+int archive_decode(flow_t *flows, uint32_t cnt, const uint8_t *data, uint32_t size, const archive_column_t *column);
+
+/*!
+ * \brief Header validation.
+ * Function to check whether the header and block index of mapped archive
+ * are supported and lie within the file.
+ * \param[in] data Pointer to the mapped archive file.
+ * \param[in] size Size of the file in bytes.
+ * \return EXIT_SUCCESS on success, otherwise EXIT_FAILURE.
+ */
+int archive_check(const char *data, size_t size);
+
+/*!
+ * \brief Allocating archive function.
+ * Function to create archive file and return a pointer to archive structure.
+ * \param[in] path Path of the archive file to be created.
+ * \return Pointer to newly created archive, otherwise NULL.
+ */
+archive_t *create_archive(const char *path);
+
+/*!
+ * \brief Writing block function.
+ * Function to compress all columns of the current block and write them into
+ * archive file.
+ * \param[in] archive Pointer to existing archive structure.
+ * \return EXIT_SUCCESS on success, otherwise EXIT_FAILURE.
+ */
+int flush_archive(archive_t *archive);
+
+/*!
+ * \brief Writing function.
+ * Function to append flow record into the current block, the block is written
+ * when it is full or the record belongs to another time partition.
+ * \param[in] archive Pointer to existing archive structure.
+ * \param[in] flow Pointer to flow record structure.
+ * \return EXIT_SUCCESS on success, otherwise EXIT_FAILURE.
+ */
+int write_archive(archive_t *archive, const flow_t *flow);
+
+/*!
+ * \brief Deallocating archive function.
+ * Function to write the last block, block index and final header and close
+ * archive file.
+ * \param[in] archive Pointer to existing archive structure.
+ * \return EXIT_SUCCESS on success, otherwise EXIT_FAILURE.
+ */
+int free_archive(archive_t *archive);
+
+#endif /* _ARCHIVE_ */
@@ -0,0 +1,80 @@
+/*!
+ * \file arena.c
+ * \brief Memory arena library.
+ * \author Jan Neuzil <neuzija1@fit.cvut.cz>
+ * \date 2014
+ */
+/*
+ * Copyright (C) 2014 ISEP
+ */
+
+#include "arena.h"
+
+arena_t *create_arena(size_t slab_size)
+{
+   arena_t *arena;
+
+   arena = (arena_t *) calloc(1, sizeof(arena_t));
+   if (arena == NULL) {
+      fprintf(stderr, "%sNot enough memory for memory arena.\n", ERROR);
+      return NULL;
+   }
+   arena->slab_size = slab_size;
+   arena->slabs_cnt = 0;
+   arena->slabs = NULL;
+   return arena;
+}
+
+void free_arena(arena_t *arena)
+{
+   slab_t *slab;
+
+   if (arena != NULL) {
+      while (arena->slabs != NULL) {
+         slab = arena->slabs;
+         arena->slabs = slab->next;
+         free(slab);
+      }
+      free(arena);
+   }
+}
+
+void *alloc_arena(arena_t *arena, size_t size)
+{
+   size_t header, slab_size;
+   slab_t *slab;
+   void *mem;
+
+   header = (sizeof(slab_t) + ARENA_ALIGN - 1) & ~((size_t) ARENA_ALIGN - 1);
+   size = (size + ARENA_ALIGN - 1) & ~((size_t) ARENA_ALIGN - 1);
+
+   // Allocating a new slab if the current one is full, zeroed pages are mapped lazily.
+   slab = arena->slabs;
+   if (slab == NULL || slab->used + size > slab->size) {
+      slab_size = arena->slab_size;
+      if (header + size > slab_size) {
+         slab_size = header + size;
+      }
+      slab = (slab_t *) calloc(1, slab_size);
+      if (slab == NULL) {
+         fprintf(stderr, "%sNot enough memory for memory arena.\n", ERROR);
+         return NULL;
+      }
+      slab->size = slab_size;
+      slab->used = header;
+
+      // Keeping the current slab in use if the new one has been filled at once.
+      if (arena->slabs != NULL && header + size > arena->slab_size) {
+         slab->next = arena->slabs->next;
+         arena->slabs->next = slab;
+      } else {
+         slab->next = arena->slabs;
+         arena->slabs = slab;
+      }
+      arena->slabs_cnt ++;
+   }
+
+   mem = (uint8_t *) slab + slab->used;
+   slab->used += size;
+   return mem;
+}
@@ -0,0 +1,71 @@
+/*!
+ * \file arena.h
+ * \brief Header file to memory arena library.
+ * \author Jan Neuzil <neuzija1@fit.cvut.cz>
+ * \date 2014
+ */
+/*
+ * Copyright (C) 2014 ISEP
+ */
+
+#ifndef _ARENA_
+#define _ARENA_
+
+#include "main.h"
+
+/*!
+ * \name Arena values.
+ * Defines macros used by memory arena carving hosts out of slabs.
+ * \{ */
+#define ARENA_SLAB 4194304 /*!< Size of a slab allocated at once. */
+#define ARENA_ALIGN 16 /*!< Alignment of memory carved out of a slab. */
+/*! \} */
+
+/*!
+ * \brief Slab structure.
+ * Header of contiguous block of memory, the memory itself follows the header.
+ */
+typedef struct slab {
+   struct slab *next; /*!< Previously allocated slab. */
+   size_t size; /*!< Size of the slab including the header. */
+   size_t used; /*!< Offset of the first free byte of the slab. */
+} slab_t;
+
+/*!
+ * \brief Arena structure.
+ * Chain of slabs from which zeroed memory is carved sequentially. Memory
+ * cannot be freed separately, all slabs are freed at once with the arena.
+ */
+typedef struct arena {
+   size_t slab_size; /*!< Size of a regular slab. */
+   uint64_t slabs_cnt; /*!< Number of allocated slabs. */
+   slab_t *slabs; /*!< The most recently allocated slab. */
+} arena_t;
+
+/*!
+ * \brief Allocating arena function.
+ * Function to allocate empty arena, slabs are allocated on demand.
+ * \param[in] slab_size Size of a regular slab.
+ * \return Pointer to newly created arena, otherwise NULL.
+ */
+arena_t *create_arena(size_t slab_size);
+
+/*!
+ * \brief Deallocating arena function.
+ * Function to free arena with all its slabs and so all memory carved out of them.
+ * \param[in] arena Pointer to existing arena.
+ */
+void free_arena(arena_t *arena);
+
+/*!
+ * \brief Allocating memory function.
+ * Function to carve zeroed and aligned memory out of the current slab, a new
+ * slab is allocated if the current one is full. Requests larger than a regular
+ * slab get a slab of their own.
+ * \param[in] arena Pointer to existing arena.
+ * \param[in] size Size of requested memory.
+ * \return Pointer to allocated memory, otherwise NULL.
+ */
+void *alloc_arena(arena_t *arena, size_t size);
+
+#endif
@@ -0,0 +1,205 @@
+/*!
+ * \file cache.c
+ * \brief Flow cache library.
+ * \author Jan Neuzil <neuzija1@fit.cvut.cz>
+ * \date 2014
+ */
+/*
+ * Copyright (C) 2014 ISEP
+ */
+
+#include "cache.h"
+
+cache_t *create_cache(uint32_t size, int idle, int active)
+{
+   uint32_t buckets, i;
+   cache_t *cache;
+
+   cache = (cache_t *) calloc(1, sizeof(cache_t));
+   if (cache == NULL) {
+      fprintf(stderr, "%sNot enough memory for flow cache.\n", ERROR);
+      return NULL;
+   }
+   cache->idle = idle;
+   cache->active = active;
+   cache->entries_max = size;
+   cache->oldest = CACHE_NONE;
+   cache->newest = CACHE_NONE;
+
+   // Keeping the load factor of hash table at most one half.
+   buckets = 1;
+   while (buckets < 2 * size) {
+      buckets <<= 1;
+   }
+   cache->mask = buckets - 1;
+
+   cache->buckets = (uint32_t *) malloc(buckets * sizeof(uint32_t));
+   cache->entries = (cache_entry_t *) malloc(size * sizeof(cache_entry_t));
+   if (cache->buckets == NULL || cache->entries == NULL) {
+      fprintf(stderr, "%sNot enough memory for flow cache.\n", ERROR);
+      free_cache(cache);
+      return NULL;
+   }
+   for (i = 0; i < buckets; i ++) {
+      cache->buckets[i] = CACHE_NONE;
+   }
+
+   // Chaining all entries into the list of free entries.
+   for (i = 0; i < size; i ++) {
+      cache->entries[i].next = i + 1;
+   }
+   cache->entries[size - 1].next = CACHE_NONE;
+   cache->free = 0;
+   return cache;
+}
+
+void free_cache(cache_t *cache)
+{
+   if (cache != NULL) {
+      free(cache->buckets);
+      free(cache->entries);
+      free(cache);
+   }
+}
+
+uint32_t hash_flow(const flow_t *flow)
+{
+   uint64_t key;
+
+   key = ((uint64_t) flow->src_ip << 32) | flow->dst_ip;
+   key ^= ((uint64_t) flow->src_port << 40) | ((uint64_t) flow->dst_port << 24) | flow->protocol;
+   key *= 0x9e3779b97f4a7c15ULL;
+   return (uint32_t) (key >> 32);
+}
+
+void expire_entry(cache_t *cache, uint32_t idx)
+{
+   uint32_t *link;
+   cache_entry_t *entry;
+
+   entry = &(cache->entries[idx]);
+
+   // Unlinking the entry from its hash chain.
+   link = &(cache->buckets[hash_flow(&(entry->flow)) & cache->mask]);
+   while (*link != idx) {
+      link = &(cache->entries[*link].next);
+   }
+   *link = entry->next;
+
+   // Unlinking the entry from the list ordered by the last packet.
+   if (entry->older != CACHE_NONE) {
+      cache->entries[entry->older].newer = entry->newer;
+   } else {
+      cache->oldest = entry->newer;
+   }
+   if (entry->newer != CACHE_NONE) {
+      cache->entries[entry->newer].older = entry->older;
+   } else {
+      cache->newest = entry->older;
+   }
+
+   cache->expired[cache->expired_cnt ++] = entry->flow;
+   cache->flows_cnt ++;
+   cache->entries_cnt --;
+   entry->next = cache->free;
+   cache->free = idx;
+}
+
+void update_cache(cache_t *cache, const packet_t *packet)
+{
+   uint32_t bucket, idx;
+   cache_entry_t *entry;
+   flow_t key, *flow;
+
+   cache->packets_cnt ++;
+   memset(&key, 0, sizeof(flow_t));
+   key.src_ip = packet->src_ip;
+   key.dst_ip = packet->dst_ip;
+   key.src_port = packet->src_port;
+   key.dst_port = packet->dst_port;
+   key.protocol = packet->protocol;
+   bucket = hash_flow(&key) & cache->mask;
+
+   // Finding the flow of the packet.
+   for (idx = cache->buckets[bucket]; idx != CACHE_NONE; idx = entry->next) {
+      entry = &(cache->entries[idx]);
+      flow = &(entry->flow);
+      if (flow->src_ip == packet->src_ip && flow->dst_ip == packet->dst_ip && flow->src_port == packet->src_port &&
+          flow->dst_port == packet->dst_port && flow->protocol == packet->protocol) {
+         break;
+      }
+   }
+
+   // Expiring long lasting flow, the packet starts a new one.
+   if (idx != CACHE_NONE && packet->time - entry->flow.time_first >= cache->active) {
+      expire_entry(cache, idx);
+      idx = CACHE_NONE;
+   }
+
+   if (idx == CACHE_NONE) {
+      // Expiring the flow with the oldest last packet if the cache is full.
+      if (cache->free == CACHE_NONE) {
+         cache->evicted_cnt ++;
+         expire_entry(cache, cache->oldest);
+      }
+
+      idx = cache->free;
+      entry = &(cache->entries[idx]);
+      cache->free = entry->next;
+      cache->entries_cnt ++;
+
+      entry->flow = key;
+      entry->flow.time_first = packet->time;
+      entry->next = cache->buckets[bucket];
+      cache->buckets[bucket] = idx;
+   } else {
+      // Unlinking the entry to be moved to the newest end of the list.
+      if (entry->older != CACHE_NONE) {
+         cache->entries[entry->older].newer = entry->newer;
+      } else {
+         cache->oldest = entry->newer;
+      }
+      if (entry->newer != CACHE_NONE) {
+         cache->entries[entry->newer].older = entry->older;
+      } else {
+         cache->newest = entry->older;
+      }
+   }
+
+   // Linking the entry as the newest one.
+   entry->older = cache->newest;
+   entry->newer = CACHE_NONE;
+   if (cache->newest != CACHE_NONE) {
+      cache->entries[cache->newest].newer = idx;
+   } else {
+      cache->oldest = idx;
+   }
+   cache->newest = idx;
+
+   // Aggregating the packet, only connection attempts set the SYN flag.
+   flow = &(entry->flow);
+   if (packet->time > flow->time_last) {
+      flow->time_last = packet->time;
+   }
+   flow->packets ++;
+   flow->bytes += packet->length;
+   if (packet->protocol == PROTOCOL_TCP && (packet->tcp_flags & (TCP_SYN | TCP_ACK)) == TCP_SYN) {
+      flow->syn_flag = 1;
+   }
+
+   // Expiring finished TCP connection.
+   if (packet->protocol == PROTOCOL_TCP && (packet->tcp_flags & (TCP_FIN | TCP_RST)) != 0) {
+      expire_entry(cache, idx);
+   }
+}
+
+uint32_t expire_cache(cache_t *cache, time_t now, int flush)
+{
+   while (cache->oldest != CACHE_NONE && cache->expired_cnt < CACHE_EXPIRED) {
+      if (!flush && now - cache->entries[cache->oldest].flow.time_last < cache->idle) {
+         break;
+      }
+      expire_entry(cache, cache->oldest);
+   }
+   return cache->expired_cnt;
+}
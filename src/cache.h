@@ -0,0 +1,117 @@
+/*!
+ * \file cache.h
+ * \brief Header file to flow cache library.
+ * \author Jan Neuzil <neuzija1@fit.cvut.cz>
+ * \date 2014
+ */
+/*
+ * Copyright (C) 2014 ISEP
+ */
+
+#ifndef _CACHE_
+#define _CACHE_
+
+#include "main.h"
+#include "pcap.h"
+
+/*!
+ * \name Flow cache values.
+ * Defines macros used by flow cache aggregating packets.
+ * \{ */
+#define CACHE_SIZE 262144 /*!< Maximum number of flows in the cache. */
+#define CACHE_IDLE 15 /*!< Default idle timeout of a flow in seconds. */
+#define CACHE_ACTIVE 60 /*!< Default active timeout of a flow in seconds. */
+#define CACHE_EXPIRED 4096 /*!< Size of a buffer of expired flows. */
+#define CACHE_NONE UINT32_MAX /*!< Index of no entry. */
+/*! \} */
+
+/*!
+ * \brief Cache entry structure.
+ * Flow being aggregated linked in a hash chain and in the list ordered
+ * by the last packet.
+ */
+typedef struct cache_entry {
+   flow_t flow; /*!< Aggregated flow record. */
+   uint32_t next; /*!< Next entry in the hash chain or in the list of free entries. */
+   uint32_t older; /*!< Entry with the previous last packet. */
+   uint32_t newer; /*!< Entry with the next last packet. */
+} cache_entry_t;
+
+/*!
+ * \brief Flow cache structure.
+ * Bounded hash table of flows keyed by 5-tuple with preallocated entries.
+ * Expired flows are collected in a buffer to be passed to the flow handler.
+ */
+typedef struct cache {
+   int idle; /*!< Idle timeout of a flow in seconds. */
+   int active; /*!< Active timeout of a flow in seconds. */
+   uint32_t entries_cnt; /*!< Number of cached flows. */
+   uint32_t entries_max; /*!< Maximum number of cached flows. */
+   uint32_t mask; /*!< Mask of hash table index. */
+   uint32_t free; /*!< The first free entry. */
+   uint32_t oldest; /*!< Entry with the oldest last packet. */
+   uint32_t newest; /*!< Entry with the newest last packet. */
+   uint32_t expired_cnt; /*!< Number of expired flows in the buffer. */
+   uint64_t packets_cnt; /*!< Number of aggregated packets. */
+   uint64_t flows_cnt; /*!< Number of expired flows. */
+   uint64_t evicted_cnt; /*!< Number of flows expired early as the cache was full. */
+   uint32_t *buckets; /*!< Hash table with the first entries of chains. */
+   cache_entry_t *entries; /*!< Preallocated entries. */
+   flow_t expired[CACHE_EXPIRED]; /*!< Buffer of expired flows. */
+} cache_t;
+
+/*!
+ * \brief Allocating cache function.
+ * Function to allocate flow cache with preallocated entries and hash table.
+ * \param[in] size Maximum number of cached flows.
+ * \param[in] idle Idle timeout of a flow in seconds.
+ * \param[in] active Active timeout of a flow in seconds.
+ * \return Pointer to newly created flow cache, otherwise NULL.
+ */
+cache_t *create_cache(uint32_t size, int idle, int active);
+
+/*!
+ * \brief Deallocating cache function.
+ * Function to free flow cache with all cached flows.
+ * \param[in] cache Pointer to existing flow cache.
+ */
+void free_cache(cache_t *cache);
+
+/*!
+ * \brief Hashing function.
+ * Function to compute hash of the 5-tuple of a flow.
+ * \param[in] flow Pointer to flow record structure.
+ * \return Hash of the flow key.
+ */
+uint32_t hash_flow(const flow_t *flow);
+
+/*!
+ * \brief Expiring entry function.
+ * Function to move cached flow into the buffer of expired flows and free its entry.
+ * \param[in] cache Pointer to existing flow cache.
+ * \param[in] idx Index of the entry.
+ */
+void expire_entry(cache_t *cache, uint32_t idx);
+
+/*!
+ * \brief Updating cache function.
+ * Function to add a packet to its flow. The flow expires after the active timeout,
+ * after TCP FIN or RST, or the oldest flow expires when the cache is full.
+ * The buffer of expired flows must have two free slots.
+ * \param[in] cache Pointer to existing flow cache.
+ * \param[in] packet Pointer to decoded packet.
+ */
+void update_cache(cache_t *cache, const packet_t *packet);
+
+/*!
+ * \brief Expiring cache function.
+ * Function to expire flows idle for the idle timeout until the buffer of expired
+ * flows is full.
+ * \param[in] cache Pointer to existing flow cache.
+ * \param[in] now Current time of the capture.
+ * \param[in] flush Flag to expire all cached flows.
+ * \return Number of flows in the buffer of expired flows.
+ */
+uint32_t expire_cache(cache_t *cache, time_t now, int flush);
+
+#endif
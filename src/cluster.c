@@ -9,6 +9,7 @@
  */
 
 #include "cluster.h"
+#include "simd.h"
 #include "main.h"
 
 cluster_t **create_cluster(params_t *params)
@@ -71,8 +72,9 @@ int init_cluster(graph_t *graph)
       graph->clusters[j]->hosts_cnt = 0;
       for (i = idx; i < graph->hosts_cnt; i ++) {
          if (graph->hosts[i]->stat != 0) {
+            sync_host(graph, graph->hosts[i]);
             for (m = 0; m < graph->interval_max; m ++) {
-               graph->clusters[j]->centroid[m].syn_packets = graph->hosts[j]->intervals[m].syn_packets;
+               graph->clusters[j]->centroid[m].syn_packets = syn(graph->hosts[i], m);
             }
             idx = i + 1;
             cnt ++;
@@ -83,19 +85,152 @@ int init_cluster(graph_t *graph)
    return cnt;
 }
 
+double random_cluster(uint64_t *state)
+{
+   *state ^= *state >> 12;
+   *state ^= *state << 25;
+   *state ^= *state >> 27;
+   return (double) ((*state * RANDOM_MULTIPLIER) >> 11) / RANDOM_SCALE;
+}
+
+int spread_cluster(graph_t *graph)
+{
+   int cnt, i, idx, j, m;
+   uint64_t state;
+   double sum, x, *weights;
+
+   weights = (double *) malloc(graph->hosts_cnt * sizeof(double));
+   if (weights == NULL) {
+      fprintf(stderr, "%sNot enough memory for k-means++ seeding, using the first hosts.\n", WARNING);
+      return init_cluster(graph);
+   }
+
+   // Weighting active hosts uniformly for the first centroid, chosen hosts are marked negative.
+   cnt = 0;
+   for (i = 0; i < graph->hosts_cnt; i ++) {
+      if (graph->hosts[i]->stat != 0) {
+         weights[i] = 1.0;
+         cnt ++;
+      } else {
+         weights[i] = -1.0;
+      }
+   }
+   if (cnt < graph->params->clusters) {
+      free(weights);
+      return cnt;
+   }
+
+   state = RANDOM_SEED;
+   sum = (double) cnt;
+   for (j = 0; j < graph->params->clusters; j ++) {
+      graph->clusters[j]->hosts_cnt = 0;
+
+      // Sampling a host with probability proportional to its weight.
+      idx = -1;
+      x = random_cluster(&state) * sum;
+      for (i = 0; i < graph->hosts_cnt; i ++) {
+         if (weights[i] > 0.0) {
+            idx = i;
+            x -= weights[i];
+            if (x < 0.0) {
+               break;
+            }
+         }
+      }
+      // Taking the first remaining host if all of them coincide with centroids.
+      if (idx < 0) {
+         for (i = 0; i < graph->hosts_cnt; i ++) {
+            if (weights[i] == 0.0) {
+               idx = i;
+               break;
+            }
+         }
+      }
+
+      for (m = 0; m < graph->interval_max; m ++) {
+         graph->clusters[j]->centroid[m].syn_packets = syn(graph->hosts[idx], m);
+      }
+      weights[idx] = -1.0;
+
+      // Updating squared distances to the nearest chosen centroid.
+      sum = 0.0;
+      for (i = 0; i < graph->hosts_cnt; i ++) {
+         if (weights[i] >= 0.0) {
+            x = distance_host(graph->hosts[i], graph->clusters[j], graph->interval_max);
+            if (j == 0 || x < weights[i]) {
+               weights[i] = x;
+            }
+            sum += weights[i];
+         }
+      }
+   }
+
+   free(weights);
+   return graph->params->clusters;
+}
+
+int seed_cluster(graph_t *graph)
+{
+   int cnt, i;
+
+   // Checking there are still enough hosts for all clusters.
+   if (graph->params->warm && graph->warm) {
+      cnt = 0;
+      for (i = 0; i < graph->hosts_cnt && cnt < graph->params->clusters; i ++) {
+         if (graph->hosts[i]->stat != 0) {
+            cnt ++;
+         }
+      }
+      if (cnt == graph->params->clusters) {
+         return cnt;
+      }
+   }
+   graph->warm = 0;
+   if (graph->params->seeding == SEEDING_KMEANSPP) {
+      return spread_cluster(graph);
+   }
+   return init_cluster(graph);
+}
+
+int empty_cluster(graph_t *graph)
+{
+   int cnt, j;
+
+   cnt = 0;
+   for (j = 0; j < graph->params->clusters; j ++) {
+      if (graph->clusters[j]->hosts_cnt == 0) {
+         cnt ++;
+      }
+   }
+   return cnt;
+}
+
+double distance_host(host_t *host, cluster_t *cluster, int n)
+{
+   int m;
+   double sum, x;
+
+   // Rows of the matrix by hosts are contiguous as well as the centroid.
+   if (host->matrix->col_stride == 1) {
+      return distance(&syn(host, 0), &(cluster->centroid[0].syn_packets), n);
+   }
+
+   sum = 0.0;
+   for (m = 0; m < n; m ++) {
+      x = syn(host, m) - cluster->centroid[m].syn_packets;
+      sum += square(x);
+   }
+   return sum;
+}
+
 void distance_cluster(graph_t *graph)
 {
-   int i, j, m;
-   double x;
+   int i, j;
 
    for (i = 0; i < graph->hosts_cnt; i ++) {
       if (graph->hosts[i]->stat != 0) {
          for (j = 0; j < graph->params->clusters; j ++) {
-            graph->hosts[i]->distances[j] = 0.0;
-            for (m = 0; m < graph->interval_max; m ++) {
-               x = graph->hosts[i]->intervals[m].syn_packets - graph->clusters[j]->centroid[m].syn_packets;
-               graph->hosts[i]->distances[j] += square(x);
-            }
+            graph->hosts[i]->distances[j] = distance_host(graph->hosts[i], graph->clusters[j], graph->interval_max);
          }
       }
    }
@@ -151,7 +286,7 @@ void centroid_cluster(graph_t *graph)
    for (i = 0; i < graph->hosts_cnt; i ++) {
       if (graph->hosts[i]->stat != 0) {
          for (m = 0; m < graph->interval_max; m ++) {
-            graph->clusters[graph->hosts[i]->cluster]->centroid[m].syn_packets += graph->hosts[i]->intervals[m].syn_packets;
+            graph->clusters[graph->hosts[i]->cluster]->centroid[m].syn_packets += syn(graph->hosts[i], m);
          }
       }
    }
@@ -223,7 +358,7 @@ void adjust_cluster(graph_t *graph)
          mean = 0.0;
          max = 0.0;
          for (m = 0; m < v; m ++) {
-            x = graph->hosts[i]->intervals[(idx+m)%graph->params->intvl_max].syn_packets;
+            x = syn(graph->hosts[i], (idx+m)%graph->params->intvl_max);
             mean += x;
             if (x > max) {
                max = x;
@@ -235,7 +370,7 @@ void adjust_cluster(graph_t *graph)
          dev = 0.0;
          // Calculating standard deviation of SYN flooding packets.
          for (m = 0; m < v; m ++) {
-            x = graph->hosts[i]->intervals[(idx+m)%graph->params->intvl_max].syn_packets - mean;
+            x = syn(graph->hosts[i], (idx+m)%graph->params->intvl_max) - mean;
             dev += square(x);
          }
          dev = sqrt(dev / (v - 1));
@@ -264,9 +399,10 @@ void batch_cluster(graph_t *graph)
    } else {
       graph->interval_max = graph->params->intvl_max;
    }
+   graph->iterations = 0;
 
-   // Initializing centroids of the cluster with first values in the graph.
-   if ((init_cluster(graph)) != graph->params->clusters) {
+   // Initializing centroids of the cluster with first values in the graph or the previous interval.
+   if ((seed_cluster(graph)) != graph->params->clusters) {
       fprintf(stderr, "%sNot enough data to start SYN flooding detection.\n", WARNING);
       return;
    }
@@ -274,11 +410,19 @@ void batch_cluster(graph_t *graph)
    distance_cluster(graph);
    // Assigning cluster to each observations.
    assign_cluster(graph);
+   // Seeding again if centroids of the previous interval left a cluster empty.
+   if (graph->warm && empty_cluster(graph) > 0) {
+      graph->warm = 0;
+      seed_cluster(graph);
+      distance_cluster(graph);
+      assign_cluster(graph);
+   }
    // Making backup to detect changes in next iterations.
    previous_cluster(graph);
 
    // Repeat the process until the centroids are convergent.
    while (1) {
+      graph->iterations ++;
       // Calculating new centroids coordinates.
       centroid_cluster(graph);
 
@@ -289,157 +433,400 @@ void batch_cluster(graph_t *graph)
       }
       previous_cluster(graph);
    }
+   graph->warm = (empty_cluster(graph) == 0);
 
    // Checking for false positives.
    adjust_cluster(graph);
 }
 
-void online_cluster(graph_t *graph)
+int nearest_cluster(graph_t *graph, host_t *host, double *first, double *second)
 {
-   int cnt, i, j, k, m, v;
-   double d, x, y, z;
-   uint8_t p, q;
-   uint64_t h, n;
-
-   // Number of observations
-   n = graph->hosts_cnt;
-   // Number of clusters.
-   k = graph->params->clusters;
+   int idx, j;
+   double x, y;
+
+   idx = 0;
+   x = INFINITY;
+   y = INFINITY;
+   for (j = 0; j < graph->params->clusters; j ++) {
+      host->distances[j] = distance_host(host, graph->clusters[j], graph->interval_max);
+      if (host->distances[j] < x) {
+         y = x;
+         x = host->distances[j];
+         idx = j;
+      } else if (host->distances[j] < y) {
+         y = host->distances[j];
+      }
+   }
+   *first = x;
+   *second = y;
+   return idx;
+}
+
+void hamerly_cluster(graph_t *graph)
+{
+   int far, i, idx, j, k, m, q, v;
+   double bound, first, max, next, second, x;
+   double *drift, *half, *lower, *old, *upper;
 
    // Determining the dimension of the data.
    if (graph->window_cnt == 0) {
-      v = graph->interval_idx;
+      graph->interval_max = graph->interval_idx;
    } else {
-      v = graph->params->intvl_max;
+      graph->interval_max = graph->params->intvl_max;
+   }
+   graph->iterations = 0;
+   k = graph->params->clusters;
+   v = graph->interval_max;
+
+   upper = (double *) malloc(graph->hosts_cnt * sizeof(double));
+   lower = (double *) malloc(graph->hosts_cnt * sizeof(double));
+   old = (double *) malloc(k * v * sizeof(double));
+   drift = (double *) malloc(k * sizeof(double));
+   half = (double *) malloc(k * sizeof(double));
+   if (upper == NULL || lower == NULL || old == NULL || drift == NULL || half == NULL) {
+      fprintf(stderr, "%sNot enough memory for bounds of distances, running batch k-means.\n", WARNING);
+      free(upper);
+      free(lower);
+      free(old);
+      free(drift);
+      free(half);
+      batch_cluster(graph);
+      return;
    }
 
-   // Initializing centroids of the cluster with first values in the graph.
-   if ((init_cluster(graph)) != graph->params->clusters) {
+   // Initializing centroids of the cluster with first values in the graph or the previous interval.
+   if ((seed_cluster(graph)) != k) {
       fprintf(stderr, "%sNot enough data to start SYN flooding detection.\n", WARNING);
-      return;
+      goto cleanup;
    }
 
-   // Assigning each host to the cluster based on a Euclidean distances.
-   for (i = 0; i < n; i ++) {
-      if (graph->hosts[i]->stat != 0) {
-         x = INFINITY;
-         for (j = 0; j < k; j ++) {
-            y = 0.0;
-            for (m = 0; m < v; m ++) {
-               z = graph->hosts[i]->intervals[m].syn_packets - graph->clusters[j]->centroid[m].syn_packets;
-               y += square(z);
+   // Assigning each observation to the nearest centroid with tight bounds, seeding again if a cluster is empty.
+   while (1) {
+      for (j = 0; j < k; j ++) {
+         graph->clusters[j]->hosts_cnt = 0;
+      }
+      for (i = 0; i < graph->hosts_cnt; i ++) {
+         if (graph->hosts[i]->stat != 0) {
+            idx = nearest_cluster(graph, graph->hosts[i], &first, &second);
+            graph->hosts[i]->cluster = idx;
+            graph->clusters[idx]->hosts_cnt ++;
+            upper[i] = sqrt(first) * (1.0 + BOUND_EPSILON);
+            lower[i] = sqrt(second) * (1.0 - BOUND_EPSILON);
+         }
+      }
+      if (graph->warm == 0 || empty_cluster(graph) == 0) {
+         break;
+      }
+      graph->warm = 0;
+      seed_cluster(graph);
+   }
+   previous_cluster(graph);
+
+   // Repeat the process until the centroids are convergent.
+   while (1) {
+      graph->iterations ++;
+      // Calculating new centroids coordinates and their drifts.
+      for (j = 0; j < k; j ++) {
+         for (m = 0; m < v; m ++) {
+            old[j * v + m] = graph->clusters[j]->centroid[m].syn_packets;
+         }
+      }
+      centroid_cluster(graph);
+      far = 0;
+      max = 0.0;
+      next = 0.0;
+      for (j = 0; j < k; j ++) {
+         drift[j] = sqrt(distance(&old[j * v], &(graph->clusters[j]->centroid[0].syn_packets), v)) * (1.0 + BOUND_EPSILON);
+         if (drift[j] > max) {
+            next = max;
+            max = drift[j];
+            far = j;
+         } else if (drift[j] > next) {
+            next = drift[j];
+         }
+      }
+
+      // Calculating half of the distance to the nearest other centroid.
+      for (j = 0; j < k; j ++) {
+         half[j] = INFINITY;
+      }
+      for (j = 0; j < k; j ++) {
+         for (q = j + 1; q < k; q ++) {
+            x = sqrt(distance(&(graph->clusters[j]->centroid[0].syn_packets), &(graph->clusters[q]->centroid[0].syn_packets), v));
+            x *= (1.0 - BOUND_EPSILON) / 2.0;
+            if (x < half[j]) {
+               half[j] = x;
             }
-            if (y < x) {
-               x = y;
-               graph->hosts[i]->cluster = j;
+            if (x < half[q]) {
+               half[q] = x;
             }
          }
-         graph->clusters[graph->hosts[i]->cluster]->hosts_cnt ++;
       }
-   }
 
-   // Calculating the mean and sum of squares for each cluster.
-   for (i = 0; i < k; i ++) {
-      graph->clusters[i]->dev = 0.0;
-      for (m = 0; m < v; m ++) {
-         graph->clusters[i]->centroid[m].syn_packets = 0.0;
+      for (j = 0; j < k; j ++) {
+         graph->clusters[j]->hosts_cnt = 0;
+      }
+      for (i = 0; i < graph->hosts_cnt; i ++) {
+         if (graph->hosts[i]->stat != 0) {
+            // Loosening bounds by drifts of centroids.
+            idx = graph->hosts[i]->cluster;
+            upper[i] += drift[idx] + BOUND_EPSILON * (upper[i] + drift[idx]);
+            x = (idx == far) ? next : max;
+            lower[i] -= x + BOUND_EPSILON * (fabs(lower[i]) + x);
+            bound = (lower[i] > half[idx]) ? lower[i] : half[idx];
+
+            // Computing distances only if the nearest centroid may have changed.
+            if (upper[i] * (1.0 + BOUND_EPSILON) >= bound) {
+               upper[i] = sqrt(distance_host(graph->hosts[i], graph->clusters[idx], v)) * (1.0 + BOUND_EPSILON);
+               if (upper[i] * (1.0 + BOUND_EPSILON) >= bound) {
+                  idx = nearest_cluster(graph, graph->hosts[i], &first, &second);
+                  graph->hosts[i]->cluster = idx;
+                  upper[i] = sqrt(first) * (1.0 + BOUND_EPSILON);
+                  lower[i] = sqrt(second) * (1.0 - BOUND_EPSILON);
+               }
+            }
+            graph->clusters[idx]->hosts_cnt ++;
+         }
+      }
+      if ((change_cluster(graph)) == 0) {
+         break;
       }
+      previous_cluster(graph);
+   }
+   graph->warm = (empty_cluster(graph) == 0);
+
+   // Checking for false positives.
+   adjust_cluster(graph);
+
+   // Cleaning up bounds.
+   cleanup:
+      free(upper);
+      free(lower);
+      free(old);
+      free(drift);
+      free(half);
+}
+
+void minibatch_cluster(graph_t *graph)
+{
+   int i, j, k, m, step, v;
+   long budget;
+   uint64_t cnt, state, *active, *counts, *sample;
+   double elapsed, first, norm, previous, rest, second, shift, *old;
+   host_t *host;
+   struct timespec start, now;
+
+   // Counting the time budget from the start including seeding.
+   clock_gettime(CLOCK_MONOTONIC, &start);
+
+   // Determining the dimension of the data.
+   if (graph->window_cnt == 0) {
+      graph->interval_max = graph->interval_idx;
+   } else {
+      graph->interval_max = graph->params->intvl_max;
+   }
+   graph->iterations = 0;
+   k = graph->params->clusters;
+   v = graph->interval_max;
+
+   active = (uint64_t *) malloc(graph->hosts_cnt * sizeof(uint64_t));
+   sample = (uint64_t *) malloc(graph->params->batch * sizeof(uint64_t));
+   counts = (uint64_t *) calloc(k, sizeof(uint64_t));
+   old = (double *) malloc(k * v * sizeof(double));
+   if (active == NULL || sample == NULL || counts == NULL || old == NULL) {
+      fprintf(stderr, "%sNot enough memory for mini-batch k-means, running batch k-means.\n", WARNING);
+      free(active);
+      free(sample);
+      free(counts);
+      free(old);
+      batch_cluster(graph);
+      return;
+   }
+
+   // Initializing centroids of the cluster with first values in the graph or the previous interval.
+   if ((seed_cluster(graph)) != k) {
+      fprintf(stderr, "%sNot enough data to start SYN flooding detection.\n", WARNING);
+      goto cleanup;
    }
 
-   for (i = 0; i < n; i ++) {
+   cnt = 0;
+   for (i = 0; i < graph->hosts_cnt; i ++) {
       if (graph->hosts[i]->stat != 0) {
+         active[cnt ++] = i;
+      }
+   }
+
+   // Half of the interval is left for the rest of detection unless set.
+   budget = graph->params->budget;
+   if (budget == 0) {
+      budget = graph->params->interval * 1000L / 2;
+   }
+   state = RANDOM_SEED;
+   clock_gettime(CLOCK_MONOTONIC, &now);
+   previous = (now.tv_sec - start.tv_sec) * 1000.0 + (now.tv_nsec - start.tv_nsec) / 1000000.0;
+
+   for (step = 0; step < MINIBATCH_STEPS; step ++) {
+      graph->iterations ++;
+      for (j = 0; j < k; j ++) {
          for (m = 0; m < v; m ++) {
-            graph->clusters[graph->hosts[i]->cluster]->centroid[m].syn_packets += graph->hosts[i]->intervals[m].syn_packets;
+            old[j * v + m] = graph->clusters[j]->centroid[m].syn_packets;
          }
       }
-   }
 
-   for (i = 0; i < k; i ++) {
-      for (m = 0; m < v; m ++) {
-         graph->clusters[i]->centroid[m].syn_packets /= (double) graph->clusters[i]->hosts_cnt;
+      // Assigning sampled hosts to the nearest centroids before any of them moves.
+      for (i = 0; i < graph->params->batch; i ++) {
+         sample[i] = active[(uint64_t) (random_cluster(&state) * cnt)];
+         host = graph->hosts[sample[i]];
+         host->cluster = nearest_cluster(graph, host, &first, &second);
+      }
+
+      // Moving centroids towards sampled hosts with decreasing learning rates.
+      for (i = 0; i < graph->params->batch; i ++) {
+         host = graph->hosts[sample[i]];
+         j = host->cluster;
+         counts[j] ++;
+         for (m = 0; m < v; m ++) {
+            graph->clusters[j]->centroid[m].syn_packets += (syn(host, m) - graph->clusters[j]->centroid[m].syn_packets) / (double) counts[j];
+         }
+      }
+
+      // Stopping when centroids settle or the time is over.
+      shift = 0.0;
+      norm = 0.0;
+      for (j = 0; j < k; j ++) {
+         shift += distance(&old[j * v], &(graph->clusters[j]->centroid[0].syn_packets), v);
+         for (m = 0; m < v; m ++) {
+            norm += square(graph->clusters[j]->centroid[m].syn_packets);
+         }
+      }
+      if (shift <= MINIBATCH_TOLERANCE * norm) {
+         break;
+      }
+      clock_gettime(CLOCK_MONOTONIC, &now);
+      elapsed = (now.tv_sec - start.tv_sec) * 1000.0 + (now.tv_nsec - start.tv_nsec) / 1000000.0;
+
+      // Leaving time for the final assignment of all hosts, estimated by the last step.
+      rest = (elapsed - previous) * cnt / graph->params->batch;
+      previous = elapsed;
+      if (elapsed + rest >= budget) {
+         fprintf(stderr, "%sTime budget of mini-batch k-means exhausted after %d steps.\n", WARNING, graph->iterations);
+         break;
       }
    }
 
-   for (i = 0; i < n; i ++) {
+   // Assigning all hosts to the final centroids.
+   distance_cluster(graph);
+   assign_cluster(graph);
+   graph->warm = (empty_cluster(graph) == 0);
+
+   // Checking for false positives.
+   adjust_cluster(graph);
+
+   // Cleaning up samples.
+   cleanup:
+      free(active);
+      free(sample);
+      free(counts);
+      free(old);
+}
+
+void online_cluster(graph_t *graph)
+{
+   int cnt, i, j, k, m, p, q, v;
+   double d, x, y, *sums;
+   host_t *host;
+
+   // Determining the dimension of the data.
+   if (graph->window_cnt == 0) {
+      graph->interval_max = graph->interval_idx;
+   } else {
+      graph->interval_max = graph->params->intvl_max;
+   }
+   graph->iterations = 0;
+   k = graph->params->clusters;
+   v = graph->interval_max;
+
+   sums = (double *) calloc(k * v, sizeof(double));
+   if (sums == NULL) {
+      fprintf(stderr, "%sNot enough memory for sums of clusters, running batch k-means.\n", WARNING);
+      batch_cluster(graph);
+      return;
+   }
+
+   // Initializing centroids of the cluster with first values in the graph or the previous interval.
+   if ((seed_cluster(graph)) != k) {
+      fprintf(stderr, "%sNot enough data to start SYN flooding detection.\n", WARNING);
+      goto cleanup;
+   }
+   // Assigning each host to the nearest centroid, seeding again if a cluster is empty.
+   distance_cluster(graph);
+   assign_cluster(graph);
+   if (graph->warm && empty_cluster(graph) > 0) {
+      graph->warm = 0;
+      seed_cluster(graph);
+      distance_cluster(graph);
+      assign_cluster(graph);
+   }
+
+   // Calculating sums and means of clusters.
+   for (i = 0; i < graph->hosts_cnt; i ++) {
       if (graph->hosts[i]->stat != 0) {
-         graph->hosts[i]->distances[0] = 0.0;
-         p = graph->hosts[i]->cluster;
          for (m = 0; m < v; m ++) {
-            x = graph->hosts[i]->intervals[m].syn_packets - graph->clusters[p]->centroid[m].syn_packets;
-            y = square(x);
-            graph->hosts[i]->distances[0] += y;
-            graph->clusters[p]->dev += y;
+            sums[graph->hosts[i]->cluster * v + m] += syn(graph->hosts[i], m);
          }
       }
    }
-
-   for (i = 0; i < n; i ++) {
-      p = graph->hosts[i]->cluster;
-      h = graph->clusters[p]->hosts_cnt;
-      if (h > 1) {
-         graph->hosts[i]->distances[0] = graph->hosts[i]->distances[0] * h / (h - 1);
+   for (j = 0; j < k; j ++) {
+      if (graph->clusters[j]->hosts_cnt == 0) {
+         fprintf(stderr, "%sEmpty cluster %d.\n", WARNING, j + 1);
+         continue;
+      }
+      for (m = 0; m < v; m ++) {
+         graph->clusters[j]->centroid[m].syn_packets = sums[j * v + m] / (double) graph->clusters[j]->hosts_cnt;
       }
    }
 
-   // Repeat the process until the centroids are convergent.
+   // Repeat passes over hosts until no host moves.
    while (1) {
+      graph->iterations ++;
       cnt = 0;
-      for (i = 0; i < n; i ++) {
-         if (graph->hosts[i]->stat != 0) {
-            p = graph->hosts[i]->cluster;
-            q = p;
-
-            d = graph->hosts[i]->distances[0];
-
-            for (j = 0; j < k; j ++) {
-               if (j != p) {
-                  x = (double) graph->clusters[j]->hosts_cnt;
-                  x /= (x + 1.0);
-
-                  y = 0.0;
-                  for (m = 0; m < v; m ++) {
-                     z = graph->hosts[i]->intervals[m].syn_packets - graph->clusters[j]->centroid[m].syn_packets;
-                     y += square(z) * x;
-                  }
-
-                  // Changing cluster if the distances is shorter.
-                  if (y < d) {
-                     d = y;
-                     p = j;
-                  }
-               }
-            }
-
-            // Making reassignment if the cluster has changed.
-            if (p != q) {
-               graph->clusters[q]->dev -= graph->hosts[i]->distances[0];
-               graph->clusters[p]->dev += d;
-               graph->clusters[q]->hosts_cnt --;
-               graph->clusters[p]->hosts_cnt ++;
-
-               for (m = 0; m < v; m ++) {
-                  x = graph->clusters[q]->centroid[m].syn_packets * graph->clusters[q]->hosts_cnt - graph->hosts[i]->intervals[m].syn_packets;
-                  graph->clusters[q]->centroid[m].syn_packets = x / (graph->clusters[q]->hosts_cnt - 1);
-                  y = graph->clusters[p]->centroid[m].syn_packets * graph->clusters[p]->hosts_cnt + graph->hosts[i]->intervals[m].syn_packets;
-                  graph->clusters[p]->centroid[m].syn_packets = y / (graph->clusters[p]->hosts_cnt + 1);
-               }
+      for (i = 0; i < graph->hosts_cnt; i ++) {
+         host = graph->hosts[i];
+         q = host->cluster;
+         if (host->stat == 0 || graph->clusters[q]->hosts_cnt < 2) {
+            continue;
+         }
 
-               graph->hosts[i]->cluster = p;
-
-               for (j = 0; j < n; j ++) {
-                  if ((graph->hosts[j]->stat != 0) && (graph->hosts[j]->cluster == p || graph->hosts[j]->cluster == q)) {
-                     graph->hosts[j]->distances[0] = 0.0;
-                     for (m = 0; m < v; m ++) {
-                        x = graph->hosts[j]->intervals[m].syn_packets - graph->clusters[graph->hosts[j]->cluster]->centroid[m].syn_packets;
-                        graph->hosts[j]->distances[0] += square(x);
-                     }
-                     h = graph->clusters[graph->hosts[j]->cluster]->hosts_cnt;
-                     graph->hosts[j]->distances[0] = graph->hosts[j]->distances[0] * h / (h - 1);
-                  }
+         // Finding the cluster with the largest decrease of the sum of squares.
+         x = (double) graph->clusters[q]->hosts_cnt;
+         d = distance_host(host, graph->clusters[q], v) * x / (x - 1.0);
+         p = q;
+         for (j = 0; j < k; j ++) {
+            if (j != q) {
+               x = (double) graph->clusters[j]->hosts_cnt;
+               y = distance_host(host, graph->clusters[j], v) * x / (x + 1.0);
+               if (y < d) {
+                  d = y;
+                  p = j;
                }
-               cnt ++;
             }
          }
+         if (p == q) {
+            continue;
+         }
+
+         // Moving the host, only sums and means of both clusters change.
+         graph->clusters[q]->hosts_cnt --;
+         graph->clusters[p]->hosts_cnt ++;
+         for (m = 0; m < v; m ++) {
+            x = syn(host, m);
+            sums[q * v + m] -= x;
+            sums[p * v + m] += x;
+            graph->clusters[q]->centroid[m].syn_packets = sums[q * v + m] / (double) graph->clusters[q]->hosts_cnt;
+            graph->clusters[p]->centroid[m].syn_packets = sums[p * v + m] / (double) graph->clusters[p]->hosts_cnt;
+         }
+         host->cluster = p;
+         cnt ++;
       }
 
       // K-means has converged.
@@ -447,7 +834,12 @@ void online_cluster(graph_t *graph)
          break;
       }
    }
+   graph->warm = (empty_cluster(graph) == 0);
 
    // Checking for false positives.
    adjust_cluster(graph);
+
+   // Cleaning up sums.
+   cleanup:
+      free(sums);
 }
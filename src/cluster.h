@@ -13,6 +13,50 @@
 
 #include "graph.h"
 
+/*!
+ * \name Accelerated k-means values.
+ * Defines macros used by k-means algorithm with bounds of distances.
+ * \{ */
+#define BOUND_EPSILON 1e-9 /*!< Relative margin of bounds covering rounding errors of distances. */
+/*! \} */
+
+/*!
+ * \name Seeding values.
+ * Defines macros used by the pseudorandom generator of k-means++ seeding.
+ * \{ */
+#define RANDOM_SEED 0x853c49e6748fea9bULL /*!< Fixed seed of the generator, so the seeding is reproducible. */
+#define RANDOM_MULTIPLIER 0x2545f4914f6cdd1dULL /*!< Multiplier scrambling the output of xorshift generator. */
+#define RANDOM_SCALE 9007199254740992.0 /*!< Two to the power of 53 scaling the output to the unit interval. */
+/*! \} */
+
+/*!
+ * \name Mini-batch k-means values.
+ * Defines macros used by k-means algorithm on samples of hosts.
+ * \{ */
+#define MINIBATCH_STEPS 100 /*!< Maximum number of steps of mini-batch k-means. */
+#define MINIBATCH_TOLERANCE 1e-4 /*!< Squared shift of centroids in one step relative to their squared norm to stop. */
+/*! \} */
+
+/*!
+ * \brief Clustering algorithm enumeration.
+ * Algorithm of k-means used by SYN flooding detection.
+ */
+enum cluster_algorithm {
+   ALGORITHM_LLOYD = 0, /*!< Batch k-means computing all distances in each iteration. */
+   ALGORITHM_HAMERLY = 1, /*!< Batch k-means skipping distances by bounds of Hamerly's algorithm. */
+   ALGORITHM_MINIBATCH = 2, /*!< Mini-batch k-means updating centroids by samples of hosts. */
+   ALGORITHM_ONLINE = 3 /*!< Online k-means moving hosts one by one by Hartigan's criterion. */
+};
+
+/*!
+ * \brief Seeding enumeration.
+ * Method choosing the initial centroids of k-means.
+ */
+enum cluster_seeding {
+   SEEDING_FIRST = 0, /*!< The first active hosts in order of their appearance. */
+   SEEDING_KMEANSPP = 1 /*!< Active hosts sampled by k-means++ with probability proportional to squared distance. */
+};
+
 /*!
  * \brief Allocating cluster function.
  * Function to allocate clusters to graph structure and return a pointer
@@ -39,6 +83,58 @@ void free_cluster(cluster_t **clusters, int k);
  */
 int init_cluster(graph_t *graph);
 
+/*!
+ * \brief Pseudorandom number generation.
+ * Function to generate the next number of xorshift64* generator.
+ * \param[in,out] state Pointer to the state of the generator.
+ * \return Pseudorandom number from the unit interval [0, 1).
+ */
+double random_cluster(uint64_t *state);
+
+/*!
+ * \brief Centroid spreading initialization.
+ * Function to set centroids by k-means++ seeding, the first centroid is an active
+ * host chosen uniformly, each next one is chosen with probability proportional
+ * to squared distance to the nearest centroid already chosen. The generator starts
+ * from the fixed seed, so the same data give the same centroids.
+ * \param[in] graph Pointer to existing graph structure.
+ * \return The number of initialized centroids.
+ */
+int spread_cluster(graph_t *graph);
+
+/*!
+ * \brief Centroid seeding.
+ * Function to start k-means from centroids of the previous interval if warm start
+ * is enabled and they converged without empty cluster, the windows of consecutive
+ * intervals differ in one slot only. Otherwise centroids are initialized again
+ * by the chosen seeding, the same is expected from the caller if the first
+ * assignment leaves a cluster empty.
+ * \param[in] graph Pointer to existing graph structure.
+ * \return The number of initialized centroids.
+ */
+int seed_cluster(graph_t *graph);
+
+/*!
+ * \brief Empty clusters counting.
+ * Function to count clusters without hosts, the structure is degenerated
+ * for warm start if any cluster is empty.
+ * \param[in] graph Pointer to existing graph structure.
+ * \return The number of empty clusters.
+ */
+int empty_cluster(graph_t *graph);
+
+/*!
+ * \brief Host distance calculation.
+ * Function to calculate squared Euclidean distance of the host to the centroid
+ * of the cluster by the vectorized kernel if the SYN packets of the host are
+ * contiguous, otherwise one by one.
+ * \param[in] host Pointer to host structure.
+ * \param[in] cluster Pointer to cluster structure.
+ * \param[in] n Number of dimensions.
+ * \return Squared Euclidean distance to the centroid.
+ */
+double distance_host(host_t *host, cluster_t *cluster, int n);
+
 /*!
  * \brief Distance calculation.
  * Function to calculate distances to centroids for each observation.
@@ -94,9 +190,48 @@ void adjust_cluster(graph_t *graph);
  */
 void batch_cluster(graph_t *graph);
 
+/*!
+ * \brief Nearest cluster search.
+ * Function to calculate distances of the host to all centroids and find
+ * the nearest one, ties are resolved to the lower index as by cluster assignment.
+ * \param[in] graph Pointer to existing graph structure.
+ * \param[in] host Pointer to host structure.
+ * \param[out] first Squared distance to the nearest centroid.
+ * \param[out] second Squared distance to the second nearest centroid.
+ * \return Index of the nearest cluster.
+ */
+int nearest_cluster(graph_t *graph, host_t *host, double *first, double *second);
+
+/*!
+ * \brief Accelerated k-means algorithm.
+ * Function to put host addresses into clusters by Hamerly's algorithm. Each host
+ * keeps an upper bound of distance to its centroid and a lower bound of distance
+ * to the others, bounds are loosened by drifts of centroids, so distances are
+ * computed only for hosts which may change the cluster. Bounds have a margin
+ * for rounding errors, hence assignments are identical to batch k-means.
+ * \param[in] graph Pointer to existing graph structure.
+ */
+void hamerly_cluster(graph_t *graph);
+
+/*!
+ * \brief Mini-batch k-means algorithm.
+ * Function to put host addresses into clusters by mini-batch k-means. Each step
+ * samples a fixed number of active hosts, assigns them to the nearest centroids
+ * and moves the centroids towards them with learning rate inverse to the number
+ * of hosts the centroid has received. Steps stop when centroids settle or the time
+ * budget is exhausted, all hosts are assigned to the final centroids once. The budget
+ * covers seeding, steps and the final assignment estimated by the last step, the
+ * check for false positives afterwards is not covered.
+ * \param[in] graph Pointer to existing graph structure.
+ */
+void minibatch_cluster(graph_t *graph);
+
 /*!
  * \brief Online k-means algorithm.
- * Function to put host addresses into clusters based on online k-means algorithm.
+ * Function to put host addresses into clusters based on online k-means algorithm
+ * in Hartigan's style. A host moves to the cluster where the sum of squares
+ * decreases the most, sums and sizes of clusters are kept, so a move updates
+ * only means of both clusters and one pass over hosts is linear.
  * \param[in] graph Pointer to existing graph structure.
  */
 void online_cluster(graph_t *graph);
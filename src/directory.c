@@ -0,0 +1,80 @@
+/*!
+ * \file directory.c
+ * \brief Host directory library.
+ * \author Jan Neuzil <neuzija1@fit.cvut.cz>
+ * \date 2014
+ */
+/*
+ * Copyright (C) 2014 ISEP
+ */
+
+#include "directory.h"
+
+directory_t *create_directory(const prefix_t *prefixes, int prefixes_cnt)
+{
+   int i;
+   uint32_t first, last, j;
+   directory_t *directory;
+
+   directory = (directory_t *) calloc(1, sizeof(directory_t));
+   if (directory == NULL) {
+      fprintf(stderr, "%sNot enough memory for host directory.\n", ERROR);
+      return NULL;
+   }
+
+   directory->tbl24 = (uint32_t *) calloc(TBL24_SIZE, sizeof(uint32_t));
+   if (directory->tbl24 == NULL) {
+      fprintf(stderr, "%sNot enough memory for host directory.\n", ERROR);
+      free_directory(directory);
+      return NULL;
+   }
+
+   // Marking /24 networks covered by monitored prefixes, overlaps are counted once.
+   for (i = 0; i < prefixes_cnt; i ++) {
+      first = prefixes[i].net >> 8;
+      last = first;
+      if (prefixes[i].len < 24) {
+         last = first + (1U << (24 - prefixes[i].len)) - 1;
+      }
+      for (j = first; j <= last; j ++) {
+         if (directory->tbl24[j] == 0) {
+            directory->tbl24[j] = TBL24_MONITORED;
+            directory->groups_max ++;
+         }
+      }
+   }
+
+   directory->tbl8 = (uint32_t *) calloc((size_t) directory->groups_max * TBL8_SIZE, sizeof(uint32_t));
+   if (directory->tbl8 == NULL) {
+      fprintf(stderr, "%sNot enough memory for host directory.\n", ERROR);
+      free_directory(directory);
+      return NULL;
+   }
+   return directory;
+}
+
+void free_directory(directory_t *directory)
+{
+   if (directory != NULL) {
+      free(directory->tbl24);
+      free(directory->tbl8);
+      free(directory);
+   }
+}
+
+uint32_t *search_directory(directory_t *directory, in_addr_t ip)
+{
+   uint32_t addr, *entry;
+
+   addr = ntohl(ip);
+   entry = &(directory->tbl24[addr >> 8]);
+   if (*entry == 0) {
+      return NULL;
+   }
+
+   // Assigning the next group to the network accessed for the first time.
+   if (*entry == TBL24_MONITORED) {
+      *entry = ++ directory->groups_cnt;
+   }
+   return &(directory->tbl8[(size_t) (*entry - 1) * TBL8_SIZE + (addr & 0xff)]);
+}
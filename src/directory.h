@@ -0,0 +1,67 @@
+/*!
+ * \file directory.h
+ * \brief Header file to host directory library.
+ * \author Jan Neuzil <neuzija1@fit.cvut.cz>
+ * \date 2014
+ */
+/*
+ * Copyright (C) 2014 ISEP
+ */
+
+#ifndef _DIRECTORY_
+#define _DIRECTORY_
+
+#include "main.h"
+
+/*!
+ * \name Directory values.
+ * Defines macros used by two-level host directory of monitored prefixes.
+ * \{ */
+#define TBL24_SIZE 16777216 /*!< Number of entries of the first stage indexed by upper 24 bits. */
+#define TBL8_SIZE 256 /*!< Number of entries of a second stage group indexed by lower 8 bits. */
+#define TBL24_MONITORED UINT32_MAX /*!< First stage entry of monitored /24 without a group yet. */
+/*! \} */
+
+/*!
+ * \brief Host directory structure.
+ * Two-level direct-indexed table in DIR-24-8 style mapping IPv4 address
+ * to the host id. The first stage holds group number of the /24 network,
+ * the second stage holds host ids, both stored increased by one so zero
+ * means no entry. Both stages are allocated zeroed, so only touched pages
+ * consume memory.
+ */
+typedef struct directory {
+   uint32_t groups_cnt; /*!< Number of used second stage groups. */
+   uint32_t groups_max; /*!< Number of monitored /24 networks. */
+   uint32_t *tbl24; /*!< First stage indexed by the upper 24 bits of address. */
+   uint32_t *tbl8; /*!< Second stage groups indexed by the lower 8 bits of address. */
+} directory_t;
+
+/*!
+ * \brief Allocating directory function.
+ * Function to allocate host directory sized from the list of monitored prefixes,
+ * all /24 networks covered by the prefixes are marked as monitored.
+ * \param[in] prefixes Array of monitored prefixes.
+ * \param[in] prefixes_cnt Number of monitored prefixes.
+ * \return Pointer to newly created directory, otherwise NULL.
+ */
+directory_t *create_directory(const prefix_t *prefixes, int prefixes_cnt);
+
+/*!
+ * \brief Deallocating directory function.
+ * Function to free host directory, hosts are owned by the graph.
+ * \param[in] directory Pointer to existing directory.
+ */
+void free_directory(directory_t *directory);
+
+/*!
+ * \brief Searching directory function.
+ * Function to find entry of IPv4 address in the directory by one or two memory
+ * accesses, a second stage group is assigned on the first access to the network.
+ * \param[in] directory Pointer to existing directory.
+ * \param[in] ip IPv4 address in network byte order.
+ * \return Pointer to host id increased by one, NULL if the address is not monitored.
+ */
+uint32_t *search_directory(directory_t *directory, in_addr_t ip);
+
+#endif
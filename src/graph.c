@@ -9,9 +9,30 @@
  */
 
 #include "graph.h"
+#include "shard.h"
+
+static uint16_t known_ports[KNOWN_PORTS] = {
+   20, // FTP
+   21, // FTP
+   22, // SSH
+   23, // Telnet
+   25, // SMTP
+   53, // DNS
+   80, // HTTP
+   110, // POP3
+   143, // IMAP
+   161, // SNMP
+   443, // HTTPS
+   3389, // RDP
+   4949, // Munin
+   5800, // VNC
+   5900, // VNC
+   10050 // Zabbix
+}; /*!< List of well known ports. */
 
 graph_t *create_graph(params_t *params)
 {
+   int i;
    graph_t *graph;
 
    graph = (graph_t *) calloc(1, sizeof(graph_t));
@@ -28,33 +49,73 @@ graph_t *create_graph(params_t *params)
    graph->ports_ver = 0;
    graph->ports_hor = 0;
    reset_port(graph->ports);
+   graph->touched_cnt = 0;
+   graph->unknown_max = 0;
+   graph->top_cnt = 0;
+   for (i = 0; i < KNOWN_PORTS; i ++) {
+      graph->known[known_ports[i] >> 6] |= 1ULL << (known_ports[i] & 63);
+   }
+   graph->epoch = 0;
+   graph->epoch_clear = UINT32_MAX;
+   graph->column = 0;
    graph->interval_first = graph->interval_last = 0;
    graph->window_first = graph->window_last = 0;
    graph->hosts_cnt = 0;
    graph->hosts_max = HOSTS_INIT;
+   graph->slots_max = SLOTS_INIT;
    graph->params = params;
-   graph->root = NULL;
+   graph->slots = NULL;
+   graph->directory = NULL;
+   graph->arena = NULL;
+   graph->matrix = NULL;
    graph->hosts = NULL;
+   graph->active_cnt = 0;
+   graph->active_max = HOSTS_INIT;
+   graph->active = NULL;
+   graph->shards = NULL;
+   graph->snapshot = NULL;
+   graph->copies = NULL;
+   graph->detecting = 0;
 
-   graph->root = (node_t *) calloc(1, sizeof(node_t));
-   if (graph->root == NULL) {
-      fprintf(stderr, "%sNot enough memory for node structure.\n", ERROR);
+   graph->slots = (slot_t *) calloc(graph->slots_max, sizeof(slot_t));
+   if (graph->slots == NULL) {
+      fprintf(stderr, "%sNot enough memory for hash table of hosts.\n", ERROR);
+      goto error;
+   }
+   if (params->prefixes_cnt > 0) {
+      graph->directory = create_directory(params->prefixes, params->prefixes_cnt);
+      if (graph->directory == NULL) {
+         goto error;
+      }
+   }
+   graph->arena = create_arena(ARENA_SLAB);
+   if (graph->arena == NULL) {
       goto error;
    }
-   graph->root->left = NULL;
-   graph->root->right = NULL;
    graph->hosts = (host_t **) calloc(graph->hosts_max, sizeof(host_t *));
    if (graph->hosts == NULL) {
       fprintf(stderr, "%sNot enough memory for hosts array.\n", ERROR);
       goto error;
    }
+   graph->active = (host_t **) calloc(graph->active_max, sizeof(host_t *));
+   if (graph->active == NULL) {
+      fprintf(stderr, "%sNot enough memory for hosts array.\n", ERROR);
+      goto error;
+   }
 
    if ((graph->params->mode & SYN_FLOODING) == SYN_FLOODING) {
+      graph->matrix = create_matrix(params->intvl_max, params->layout);
+      if (graph->matrix == NULL) {
+         goto error;
+      }
       graph->clusters = create_cluster(params);
       if (graph->clusters == NULL) {
          goto error;
       }
    }
+   if (params->shards > 0 && create_shards(graph) != EXIT_SUCCESS) {
+      goto error;
+   }
    return graph;
 
    // Cleaning up after error.
@@ -65,12 +126,32 @@ graph_t *create_graph(params_t *params)
 
 void free_graph(graph_t *graph)
 {
-   if (graph->root != NULL) {
-      free_host(graph->root);
+   uint64_t i;
+
+   // Hosts of the graph share distances with the snapshot being detected.
+   wait_snapshot(graph);
+   if (graph->snapshot != NULL) {
+      free_snapshot(graph->snapshot);
+   }
+   free_shards(graph);
+   if (graph->slots != NULL) {
+      free(graph->slots);
    }
+   free_directory(graph->directory);
    if (graph->hosts != NULL) {
+      // Hosts merged from shards are owned by graphs of the shards.
+      for (i = 0; i < graph->hosts_cnt && graph->params->shards == 0; i ++) {
+         if (graph->hosts[i]->extra != NULL) {
+            free_host(graph->hosts[i]);
+         }
+      }
       free(graph->hosts);
    }
+   if (graph->active != NULL) {
+      free(graph->active);
+   }
+   free_arena(graph->arena);
+   free_matrix(graph->matrix);
    if (graph->clusters != NULL) {
       free_cluster(graph->clusters, graph->params->clusters);
    }
@@ -81,41 +162,239 @@ void free_graph(graph_t *graph)
 
 void reset_graph(graph_t *graph)
 {
-   int i, j;
+   int clear, trace;
+   uint32_t i;
+   uint64_t cnt, j;
+   host_t *host;
 
    graph->attack = 0;
    graph->ports_ver = 0;
    graph->ports_hor = 0;
+   graph->epoch ++;
 
-   for (i = 0; i < graph->hosts_cnt; i ++) {
-      graph->hosts[i]->accesses = 0;
+   // Columns of SYN matrix are cleared lazily when a host is accessed again.
+   clear = ((graph->params->mode & SYN_FLOODING) == SYN_FLOODING) && (graph->window_cnt != 0);
+   if (clear) {
+      if (graph->epoch_clear == UINT32_MAX) {
+         graph->epoch_clear = graph->epoch;
+      }
+      graph->column = (graph->interval_idx+ARRAY_EXTRA)%graph->params->intvl_max;
    }
-   
-   if (((graph->params->mode & SYN_FLOODING) == SYN_FLOODING) && (graph->window_cnt != 0)) {
-      for (i = 0; i < graph->hosts_cnt; i ++) {
-         graph->hosts[i]->stat = 0;
-         graph->hosts[i]->cluster = 0;
-         graph->hosts[i]->intervals[(graph->interval_idx+ARRAY_EXTRA)%graph->params->intvl_max].syn_packets = 0;
+
+   // Resetting only hosts accessed since their last reset, other hosts are already reset.
+   trace = (((graph->params->mode & VER_PORTSCAN) == VER_PORTSCAN) || ((graph->params->mode & HOR_PORTSCAN) == HOR_PORTSCAN)) &&
+           (graph->host_level > LEVEL_INFO);
+   cnt = 0;
+   for (j = 0; j < graph->active_cnt; j ++) {
+      host = graph->active[j];
+      host->accesses = 0;
+      if (clear) {
+         host->stat = 0;
+         host->cluster = 0;
+      }
+      if (trace) {
+         if (host->extra != NULL) {
+            reset_extra(host->extra);
+         }
+         host->stat = 0;
+      }
+
+      // Keeping hosts with SYN packets until the first time window is reached.
+      if (host->stat != 0 || host->cluster != 0) {
+         graph->active[cnt ++] = host;
+      } else {
+         host->listed = 0;
       }
    }
+   graph->active_cnt = cnt;
 
    if (((graph->params->mode & VER_PORTSCAN) == VER_PORTSCAN) || ((graph->params->mode & HOR_PORTSCAN) == HOR_PORTSCAN)) {
-      reset_port(graph->ports);
-      if (graph->host_level > LEVEL_INFO) {
-         for (i = 0; i < graph->hosts_cnt; i ++) {
-            for (j = 0; j < graph->hosts[i]->extra->ports_cnt; j ++) {
-               graph->hosts[i]->extra->ports[j]->accesses = 0;
-            }
-            graph->hosts[i]->stat = 0;
+      for (i = 0; i < graph->touched_cnt; i ++) {
+         graph->ports[graph->touched[i]].accesses = 0;
+      }
+      graph->touched_cnt = 0;
+      graph->unknown_max = 0;
+      graph->top_cnt = 0;
+   }
+
+   if (graph->shards != NULL) {
+      reset_shards(graph);
+   }
+}
+
+graph_t *create_snapshot(params_t *params)
+{
+   graph_t *snapshot;
+
+   snapshot = (graph_t *) calloc(1, sizeof(graph_t));
+   if (snapshot == NULL) {
+      fprintf(stderr, "%sNot enough memory for graph snapshot.\n", ERROR);
+      return NULL;
+   }
+   snapshot->hosts_max = HOSTS_INIT;
+
+   snapshot->params = (params_t *) malloc(sizeof(params_t));
+   snapshot->hosts = (host_t **) calloc(snapshot->hosts_max, sizeof(host_t *));
+   snapshot->copies = (host_t *) calloc(snapshot->hosts_max, sizeof(host_t));
+   if (snapshot->params == NULL || snapshot->hosts == NULL || snapshot->copies == NULL) {
+      fprintf(stderr, "%sNot enough memory for graph snapshot.\n", ERROR);
+      goto error;
+   }
+   *(snapshot->params) = *params;
+
+   if ((params->mode & SYN_FLOODING) == SYN_FLOODING) {
+      snapshot->matrix = create_matrix(params->intvl_max, params->layout);
+      if (snapshot->matrix == NULL) {
+         goto error;
+      }
+      snapshot->clusters = create_cluster(params);
+      if (snapshot->clusters == NULL) {
+         goto error;
+      }
+   }
+   return snapshot;
+
+   // Cleaning up after error.
+   error:
+      free_snapshot(snapshot);
+      return NULL;
+}
+
+void free_snapshot(graph_t *snapshot)
+{
+   uint64_t i;
+
+   for (i = 0; i < snapshot->hosts_cnt; i ++) {
+      if (snapshot->copies[i].extra != NULL) {
+         free_extra(snapshot->copies[i].extra);
+      }
+   }
+   free(snapshot->hosts);
+   free(snapshot->copies);
+   free_matrix(snapshot->matrix);
+   if (snapshot->clusters != NULL) {
+      free_cluster(snapshot->clusters, snapshot->params->clusters);
+   }
+   free(snapshot->params);
+   free(snapshot);
+}
+
+int take_snapshot(graph_t *graph)
+{
+   int m;
+   uint64_t hosts_max, i;
+   host_t *copies, *copy, *host, **hosts;
+   graph_t *snapshot;
+
+   if (graph->snapshot == NULL) {
+      graph->snapshot = create_snapshot(graph->params);
+      if (graph->snapshot == NULL) {
+         return EXIT_FAILURE;
+      }
+   }
+   snapshot = graph->snapshot;
+   *(snapshot->params) = *(graph->params);
+
+   // Growing arrays to hold all hosts of the graph.
+   if (graph->hosts_cnt > snapshot->hosts_max) {
+      hosts_max = snapshot->hosts_max;
+      while (hosts_max < graph->hosts_cnt) {
+         hosts_max *= 2;
+      }
+      hosts = (host_t **) realloc(snapshot->hosts, hosts_max * sizeof(host_t *));
+      if (hosts == NULL) {
+         fprintf(stderr, "%sNot enough memory for graph snapshot.\n", ERROR);
+         return EXIT_FAILURE;
+      }
+      snapshot->hosts = hosts;
+      copies = (host_t *) realloc(snapshot->copies, hosts_max * sizeof(host_t));
+      if (copies == NULL) {
+         fprintf(stderr, "%sNot enough memory for graph snapshot.\n", ERROR);
+         return EXIT_FAILURE;
+      }
+      snapshot->copies = copies;
+      snapshot->hosts_max = hosts_max;
+   }
+
+   // Copying the state of the interval.
+   snapshot->attack = graph->attack;
+   snapshot->host_level = graph->host_level;
+   snapshot->interval_idx = graph->interval_idx;
+   snapshot->interval_cnt = graph->interval_cnt;
+   snapshot->ports_ver = graph->ports_ver;
+   snapshot->ports_hor = graph->ports_hor;
+   snapshot->unknown_max = graph->unknown_max;
+   snapshot->top_cnt = graph->top_cnt;
+   memcpy(snapshot->top, graph->top, sizeof(graph->top));
+   memcpy(snapshot->known, graph->known, sizeof(graph->known));
+   if (((graph->params->mode & VER_PORTSCAN) == VER_PORTSCAN) || ((graph->params->mode & HOR_PORTSCAN) == HOR_PORTSCAN)) {
+      memcpy(snapshot->ports, graph->ports, sizeof(graph->ports));
+   }
+   snapshot->epoch = graph->epoch;
+   snapshot->epoch_clear = graph->epoch_clear;
+   snapshot->column = graph->column;
+   snapshot->window_cnt = graph->window_cnt;
+   snapshot->interval_first = graph->interval_first;
+   snapshot->interval_last = graph->interval_last;
+   snapshot->window_first = graph->window_first;
+   snapshot->window_last = graph->window_last;
+
+   // Releasing ports of the previous snapshot, they are reset in the graph with the interval.
+   for (i = 0; i < snapshot->hosts_cnt; i ++) {
+      if (snapshot->copies[i].extra != NULL) {
+         free_extra(snapshot->copies[i].extra);
+         snapshot->copies[i].extra = NULL;
+      }
+   }
+   snapshot->hosts_cnt = 0;
+
+   // Copying only hosts seen by detection, idle hosts keep their order in the graph.
+   if (snapshot->matrix != NULL) {
+      clear_matrix(snapshot->matrix);
+   }
+   for (i = 0; i < graph->hosts_cnt; i ++) {
+      host = graph->hosts[i];
+      if (host->accesses == 0 && host->stat == 0 && host->extra == NULL) {
+         continue;
+      }
+      copy = &(snapshot->copies[snapshot->hosts_cnt]);
+      *copy = *host;
+      copy->extra = NULL;
+      copy->matrix = NULL;
+      snapshot->hosts[snapshot->hosts_cnt ++] = copy;
+      if (snapshot->matrix != NULL && host->stat != 0) {
+         if (add_row(snapshot->matrix, &(copy->row)) != EXIT_SUCCESS) {
+            return EXIT_FAILURE;
+         }
+         copy->matrix = snapshot->matrix;
+         for (m = 0; m < graph->params->intvl_max; m ++) {
+            syn(copy, m) = syn(host, m);
+         }
+      }
+      if (host->extra != NULL) {
+         copy->extra = copy_extra(host->extra);
+         if (copy->extra == NULL) {
+            return EXIT_FAILURE;
          }
       }
    }
+   return EXIT_SUCCESS;
+}
+
+void wait_snapshot(graph_t *graph)
+{
+   if (graph->detecting) {
+      pthread_join(graph->detector, NULL);
+      graph->detecting = 0;
+   }
 }
 
 void print_graph(graph_t *graph)
 {
    int i, j, p, sum;
+   uint32_t pos;
    char buffer[BUFFER_TMP], date[BUFFER_TMP], ip[INET_ADDRSTRLEN], name[BUFFER_TMP];
+   port_t port;
    FILE *f;
    struct tm *time;
    struct hostent *he;
@@ -166,7 +445,7 @@ void print_graph(graph_t *graph)
    fprintf(f, "Number of active hosts:            %*d\n", p, sum);
 
    if ((graph->params->mode & VER_PORTSCAN) == VER_PORTSCAN) {
-      fprintf(f, "Number of ports used:              %*d\n", p, graph->ports_ver);
+      fprintf(f, "Number of ports used:              %*u\n", p, graph->ports_ver);
    }
    if ((graph->params->mode & HOR_PORTSCAN) == HOR_PORTSCAN) {
       fprintf(f, "Maximum port accesses:             %*u\n", p, graph->ports_hor);
@@ -174,6 +453,7 @@ void print_graph(graph_t *graph)
    if ((graph->params->mode & SYN_FLOODING) == SYN_FLOODING) {
       if (graph->interval_cnt > CONVERGENCE) {
          fprintf(f, "Number of clusters:                %*d\n", p, graph->params->clusters);
+         fprintf(f, "Number of iterations:              %*d\n", p, graph->iterations);
          for (i = 0; i < graph->params->clusters; i ++) {
             fprintf(f, "* Hosts in cluster %d:              %*lu\n", i + 1, p, graph->clusters[i]->hosts_cnt);
          }
@@ -209,10 +489,10 @@ void print_graph(graph_t *graph)
 
     if ((graph->attack & HOR_PORTSCAN) == HOR_PORTSCAN) {
        fprintf(f, "\nHorizontal port scan attack brief:\n");
-       for (i = 0; i < TOP_ACCESSED; i ++) {
+       for (i = 0; i < graph->top_cnt; i ++) {
           fprintf(f, "* Destination port:                %*d\n"
                      "* Times accessed:                  %*u\n",
-                  p, graph->ports[i].port_num, p, graph->ports[i].accesses);
+                  p, graph->ports[graph->top[i]].port_num, p, graph->ports[graph->top[i]].accesses);
        }
        if (graph->params->level >= VERBOSE_BASIC) {
           print_host(graph, 0, HOR_PORTSCAN);
@@ -228,7 +508,7 @@ void print_graph(graph_t *graph)
             fprintf(f, "* Destination IP address:          %*s\n"
                        "* Times accessed:                  %*d\n",
                     p, ip, p, graph->hosts[i]->accesses);
-            if (graph->hosts[i]->level > LEVEL_INFO) {
+            if (graph->hosts[i]->extra != NULL) {
                fprintf(f, "* Ports used:                      %*u\n", p, graph->hosts[i]->extra->ports_cnt);
             }
 
@@ -247,17 +527,18 @@ void print_graph(graph_t *graph)
                   fprintf(f, "* Observation intervals:\n");
                   for (j = 0; j < graph->params->interval; j ++) {
                      fprintf(f, "* \t%02d) SYN packets:           %*.0lf\n",
-                             j, p, graph->hosts[i]->intervals[(graph->interval_idx+ARRAY_EXTRA+j)%graph->params->intvl_max].syn_packets);
+                             j, p, syn(graph->hosts[i], (graph->interval_idx+ARRAY_EXTRA+j)%graph->params->intvl_max));
                   }
                }
-               if (graph->hosts[i]->level > LEVEL_INFO) {
+               if (graph->hosts[i]->extra != NULL) {
                   // Printing number of accesses on each port in the observation interval.
                   fprintf(f, "* Times port accessed:\n");
-                  for (j = 0; j < graph->hosts[i]->extra->ports_cnt; j ++) {
-                     if (graph->hosts[i]->extra->ports[j]->accesses > 0) {
+                  pos = 0;
+                  while (next_port(graph->hosts[i]->extra, &pos, &port)) {
+                     if (port.accesses > 0) {
                         fprintf(f, "* \tDestination port:          %*d\n"
                                    "* \tTimes accessed:            %*u\n",
-                                p, graph->hosts[i]->extra->ports[j]->port_num, p, graph->hosts[i]->extra->ports[j]->accesses);
+                                p, port.port_num, p, port.accesses);
                      }
                   }
                }
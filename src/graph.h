@@ -32,11 +32,48 @@ void free_graph(graph_t *graph);
 /*!
  * \brief Reseting graph function
  * Function to reset graph structure and transfer all the residues
- * to the next iteration of a time window.
+ * to the next iteration of a time window. Only hosts and ports accessed
+ * since their last reset are reset, SYN packets of hosts are cleared
+ * lazily by synchronizing function.
  * \param[in] graph Pointer to existing graph structure.
  */
 void reset_graph(graph_t *graph);
 
+/*!
+ * \brief Allocating snapshot function.
+ * Function to allocate graph holding copies of hosts and their SYN packets,
+ * clusters and own copy of parameters to run detection over a frozen interval.
+ * \param[in] params Pointer to structure with all initialized parameters.
+ * \return Pointer to newly created snapshot, otherwise NULL.
+ */
+graph_t *create_snapshot(params_t *params);
+
+/*!
+ * \brief Deallocating snapshot function.
+ * Function to free snapshot with copies of hosts.
+ * \param[in] snapshot Pointer to existing snapshot.
+ */
+void free_snapshot(graph_t *snapshot);
+
+/*!
+ * \brief Taking snapshot function.
+ * Function to copy the state of the interval needed by detection into the snapshot
+ * of the graph, it is allocated on the first use. Only hosts accessed in the interval,
+ * to be clustered or with ports are copied, SYN packets are copied for hosts to be
+ * clustered. Distances are shared with the hosts of the graph, they are used by
+ * detection only.
+ * \param[in] graph Pointer to existing graph structure.
+ * \return EXIT_SUCCESS on success, otherwise EXIT_FAILURE.
+ */
+int take_snapshot(graph_t *graph);
+
+/*!
+ * \brief Waiting snapshot function.
+ * Function to wait until detection over the snapshot of the graph finishes.
+ * \param[in] graph Pointer to existing graph structure.
+ */
+void wait_snapshot(graph_t *graph);
+
 /*!
  * \brief Statistics graph function.
  * Function to print all statistics about hosts in graph into a file or create
@@ -20,298 +20,472 @@ void reset_port(port_t ports[ALL_PORTS])
    }
 }
 
-node_t *search_port(uint16_t port, node_t *root)
+void update_top(graph_t *graph, uint16_t port)
 {
    int i;
-   uint32_t mask;
-   node_t *node, *tmp;
-
-   mask = MASK_PORT;
-   node = root;
-
-   for (i = 0; i < BITS_PORT; i ++) {
-      if (port & mask) {
-         // Creating new node to the left.
-         if (node->left == NULL) {
-            tmp = (node_t *) calloc(1, sizeof(node_t));
-            if (tmp == NULL) {
-               fprintf(stderr, "%sNot enough memory for node structure.\n", ERROR);
-               return NULL;
-            }
-            node->left = tmp;
-            node = tmp;
-         }
-         // Continuing in binary tree.
-         else {
-            node = node->left;
-         }
-      }
+   uint16_t tmp;
 
-      else {
-         // Creating new node to the right.
-         if (node->right == NULL) {
-            tmp = (node_t *) calloc(1, sizeof(node_t));
-            if (tmp == NULL) {
-               fprintf(stderr, "%sNot enough memory for node structure.\n", ERROR);
-               return NULL;
-            }
-            node->right = tmp;
-            node = tmp;
-         }
-         // Continuing in binary tree.
-         else {
-            node = node->right;
-         }
+   // Finding the port among the most accessed ports.
+   for (i = 0; i < graph->top_cnt; i ++) {
+      if (graph->top[i] == port) {
+         break;
       }
+   }
 
-      // Pushing one bit to the left.
-      port <<= 1;
+   // Replacing the least accessed port if the port has overtaken it.
+   if (i == graph->top_cnt) {
+      if (graph->top_cnt < TOP_ACCESSED) {
+         graph->top_cnt ++;
+      } else if (ahead(graph, port, graph->top[TOP_ACCESSED - 1])) {
+         i = TOP_ACCESSED - 1;
+      } else {
+         return;
+      }
+      graph->top[i] = port;
    }
 
-   return node;
+   // Moving the port forward as its accesses has grown.
+   while (i > 0 && ahead(graph, graph->top[i], graph->top[i - 1])) {
+      tmp = graph->top[i - 1];
+      graph->top[i - 1] = graph->top[i];
+      graph->top[i] = tmp;
+      i --;
+   }
 }
 
-void free_port(node_t *node)
+void count_port(graph_t *graph, uint16_t port)
 {
-   // Deleting siblings to the left if exist.
-   if (node->left != NULL) {
-      free_port(node->left);
+   uint32_t accesses;
+
+   accesses = ++ graph->ports[port].accesses;
+   if (accesses == 1) {
+      graph->touched[graph->touched_cnt ++] = port;
+      graph->ports_ver ++;
+   }
+   if ((graph->known[port >> 6] & (1ULL << (port & 63))) == 0 && accesses > graph->unknown_max) {
+      graph->unknown_max = accesses;
    }
+   update_top(graph, port);
+}
 
-   // Deleting siblings to the right if exist.
-   if (node->right != NULL) {
-      free_port(node->right);
+void fill_top(graph_t *graph)
+{
+   int i;
+   uint32_t port;
+
+   // Not accessed ports follow in ascending order if less ports have been accessed.
+   port = 0;
+   while (graph->top_cnt < TOP_ACCESSED) {
+      for (i = 0; i < graph->top_cnt; i ++) {
+         if (graph->top[i] == port) {
+            break;
+         }
+      }
+      if (i == graph->top_cnt) {
+         graph->top[graph->top_cnt ++] = port;
+      }
+      port ++;
    }
+}
+
+extra_t *create_extra()
+{
+   extra_t *extra;
 
-   // Deleting host structure if exists.
-   if (node->val != NULL) {
-      free(node->val);
+   extra = (extra_t *) calloc(1, sizeof(extra_t));
+   if (extra == NULL) {
+       fprintf(stderr, "%sNot enough memory for extra host structure.\n", ERROR);
+       return NULL;
    }
 
-   // Deleting current node.
-   free(node);
+   extra->kind = PORTS_ARRAY;
+   extra->ports_cnt = 0;
+   extra->slots_max = 0;
+   extra->slots = NULL;
+   extra->bitmap = NULL;
+   extra->counters = NULL;
+   return extra;
 }
 
-port_t **add_port(port_t **ports, port_t *port, uint16_t *ports_cnt, uint16_t *ports_max)
+void free_extra(extra_t *extra)
 {
-   // Reallocating array if needed.
-   if (*ports_cnt == *ports_max) {
-      *ports_max *= 2;
-      if (*ports_max == 0) {
-         *ports_max -= 1;
+   if (extra->slots != NULL) {
+      free(extra->slots);
+   }
+   if (extra->bitmap != NULL) {
+      free(extra->bitmap);
+   }
+   if (extra->counters != NULL) {
+      free(extra->counters);
+   }
+   free(extra);
+}
+
+extra_t *copy_extra(const extra_t *extra)
+{
+   extra_t *copy;
+
+   copy = create_extra();
+   if (copy == NULL) {
+      return NULL;
+   }
+   *copy = *extra;
+   copy->slots = NULL;
+   copy->bitmap = NULL;
+   copy->counters = NULL;
+
+   if (extra->slots != NULL) {
+      copy->slots = (port_slot_t *) malloc(extra->slots_max * sizeof(port_slot_t));
+      if (copy->slots == NULL) {
+         goto error;
       }
-      port_t **tmp = (port_t **) realloc(ports, (*ports_max) * sizeof(port_t *));
-      if (tmp == NULL) {
-         fprintf(stderr, "%sNot enough memory for ports array.\n", ERROR);
-         free(ports);
-         return NULL;
+      memcpy(copy->slots, extra->slots, extra->slots_max * sizeof(port_slot_t));
+   }
+   if (extra->bitmap != NULL) {
+      copy->bitmap = (uint64_t *) malloc(ALL_PORTS / 64 * sizeof(uint64_t));
+      copy->counters = (uint32_t *) malloc(ALL_PORTS * sizeof(uint32_t));
+      if (copy->bitmap == NULL || copy->counters == NULL) {
+         goto error;
       }
-      ports = tmp;
+      memcpy(copy->bitmap, extra->bitmap, ALL_PORTS / 64 * sizeof(uint64_t));
+      memcpy(copy->counters, extra->counters, ALL_PORTS * sizeof(uint32_t));
    }
+   return copy;
 
-   // Adding new port to array of ports and updating counter.
-   ports[(*ports_cnt)++] = port;
-   return ports;
+   // Cleaning up after error.
+   error:
+      fprintf(stderr, "%sNot enough memory for copy of extra host structure.\n", ERROR);
+      free_extra(copy);
+      return NULL;
 }
 
-int compare_port(const void *elem1, const void *elem2)
+port_slot_t *search_slot(port_slot_t *slots, uint32_t slots_max, uint16_t port)
 {
-   port_t *port1, *port2;
+   uint32_t i, mask;
 
-   port1 = (port_t *) elem1;
-   port2 = (port_t *) elem2;
-   return (port2->accesses - port1->accesses);
+   mask = slots_max - 1;
+   i = (((uint32_t) port * 2654435761U) >> 16) & mask;
+   while (slots[i].key != 0 && slots[i].key != (uint32_t) port + 1) {
+      i = (i + 1) & mask;
+   }
+   return &(slots[i]);
 }
 
-extra_t *create_extra()
+int grow_ports(extra_t *extra)
 {
-   extra_t *extra;
+   uint32_t i, slots_max;
+   port_slot_t *slots, *slot;
+
+   // Switching to bitmap if the hash table would be too large.
+   if (extra->kind == PORTS_HASH && extra->slots_max * 2 > PORTS_HASH_MAX) {
+      extra->bitmap = (uint64_t *) calloc(ALL_PORTS / 64, sizeof(uint64_t));
+      extra->counters = (uint32_t *) calloc(ALL_PORTS, sizeof(uint32_t));
+      if (extra->bitmap == NULL || extra->counters == NULL) {
+         fprintf(stderr, "%sNot enough memory for ports bitmap.\n", ERROR);
+         return EXIT_FAILURE;
+      }
+      for (i = 0; i < extra->slots_max; i ++) {
+         if (extra->slots[i].key != 0) {
+            extra->bitmap[(extra->slots[i].key - 1) >> 6] |= 1ULL << ((extra->slots[i].key - 1) & 63);
+            extra->counters[extra->slots[i].key - 1] = extra->slots[i].accesses;
+         }
+      }
+      free(extra->slots);
+      extra->slots = NULL;
+      extra->slots_max = 0;
+      extra->kind = PORTS_BITMAP;
+      return EXIT_SUCCESS;
+   }
 
-   extra = (extra_t *) calloc(1, sizeof(extra_t));
-   if (extra == NULL) {
-       fprintf(stderr, "%sNot enough memory for extra host structure.\n", ERROR);
-       goto error;
+   // Moving ports from inline array or smaller hash table into larger hash table.
+   slots_max = (extra->kind == PORTS_ARRAY) ? PORTS_HASH_INIT : extra->slots_max * 2;
+   slots = (port_slot_t *) calloc(slots_max, sizeof(port_slot_t));
+   if (slots == NULL) {
+      fprintf(stderr, "%sNot enough memory for hash table of ports.\n", ERROR);
+      return EXIT_FAILURE;
    }
+   if (extra->kind == PORTS_ARRAY) {
+      for (i = 0; i < extra->ports_cnt; i ++) {
+         slot = search_slot(slots, slots_max, extra->ports[i].port_num);
+         slot->key = (uint32_t) extra->ports[i].port_num + 1;
+         slot->accesses = extra->ports[i].accesses;
+      }
+   } else {
+      for (i = 0; i < extra->slots_max; i ++) {
+         if (extra->slots[i].key != 0) {
+            *search_slot(slots, slots_max, extra->slots[i].key - 1) = extra->slots[i];
+         }
+      }
+      free(extra->slots);
+   }
+   extra->slots = slots;
+   extra->slots_max = slots_max;
+   extra->kind = PORTS_HASH;
+   return EXIT_SUCCESS;
+}
 
-   extra->ports_cnt = 0;
-   extra->ports_max = PORTS_INIT;
-   extra->root = NULL;
-   extra->ports = NULL;
+int add_access(extra_t *extra, uint16_t port)
+{
+   int first, last, mid;
+   uint64_t bit;
+   port_slot_t *slot;
+
+   if (extra->kind == PORTS_ARRAY) {
+      // Finding the port or its position in sorted array.
+      first = 0;
+      last = extra->ports_cnt;
+      while (first < last) {
+         mid = (first + last) / 2;
+         if (extra->ports[mid].port_num < port) {
+            first = mid + 1;
+         } else {
+            last = mid;
+         }
+      }
+      if (first < extra->ports_cnt && extra->ports[first].port_num == port) {
+         extra->ports[first].accesses ++;
+         return EXIT_SUCCESS;
+      }
+      if (extra->ports_cnt < PORTS_INLINE) {
+         memmove(&(extra->ports[first + 1]), &(extra->ports[first]), (extra->ports_cnt - first) * sizeof(port_t));
+         extra->ports[first].port_num = port;
+         extra->ports[first].accesses = 1;
+         extra->ports_cnt ++;
+         return EXIT_SUCCESS;
+      }
+      if (grow_ports(extra) != EXIT_SUCCESS) {
+         return EXIT_FAILURE;
+      }
+   }
+
+   if (extra->kind == PORTS_HASH) {
+      slot = search_slot(extra->slots, extra->slots_max, port);
+      if (slot->key != 0) {
+         slot->accesses ++;
+         return EXIT_SUCCESS;
+      }
+
+      // Keeping the load factor under one half for short probe sequences.
+      if ((extra->ports_cnt + 1) * 2 <= extra->slots_max) {
+         slot->key = (uint32_t) port + 1;
+         slot->accesses = 1;
+         extra->ports_cnt ++;
+         return EXIT_SUCCESS;
+      }
+      if (grow_ports(extra) != EXIT_SUCCESS) {
+         return EXIT_FAILURE;
+      }
+      if (extra->kind == PORTS_HASH) {
+         slot = search_slot(extra->slots, extra->slots_max, port);
+         slot->key = (uint32_t) port + 1;
+         slot->accesses = 1;
+         extra->ports_cnt ++;
+         return EXIT_SUCCESS;
+      }
+   }
 
-   extra->root = (node_t *) calloc(1, sizeof(node_t));
-   if (extra->root == NULL) {
-      fprintf(stderr, "%sNot enough memory for node structure.\n", ERROR);
-      goto error;
+   bit = 1ULL << (port & 63);
+   if ((extra->bitmap[port >> 6] & bit) == 0) {
+      extra->bitmap[port >> 6] |= bit;
+      extra->ports_cnt ++;
    }
-   extra->root->left = NULL;
-   extra->root->right = NULL;
-   extra->ports = (port_t **) calloc(extra->ports_max, sizeof(port_t *));
-   if (extra->ports == NULL) {
-      fprintf(stderr, "%sNot enough memory for ports array.\n", ERROR);
-      goto error;
+   extra->counters[port] ++;
+   return EXIT_SUCCESS;
+}
+
+int next_port(const extra_t *extra, uint32_t *pos, port_t *port)
+{
+   uint64_t word;
+
+   if (extra->kind == PORTS_ARRAY) {
+      if (*pos >= extra->ports_cnt) {
+         return 0;
+      }
+      *port = extra->ports[(*pos) ++];
+      return 1;
    }
 
-   error:
-      if (extra->root != NULL) {
-         free(extra->root);
+   if (extra->kind == PORTS_HASH) {
+      while (*pos < extra->slots_max && extra->slots[*pos].key == 0) {
+         (*pos) ++;
+      }
+      if (*pos >= extra->slots_max) {
+         return 0;
+      }
+      port->port_num = extra->slots[*pos].key - 1;
+      port->accesses = extra->slots[(*pos) ++].accesses;
+      return 1;
+   }
+
+   // Skipping words of the bitmap without used ports.
+   while (*pos < ALL_PORTS) {
+      word = extra->bitmap[*pos >> 6] >> (*pos & 63);
+      if (word == 0) {
+         *pos = (*pos | 63) + 1;
+         continue;
       }
-      if (extra->ports != NULL) {
-         free(extra->ports);
+      *pos += __builtin_ctzll(word);
+      port->port_num = *pos;
+      port->accesses = extra->counters[(*pos) ++];
+      return 1;
+   }
+   return 0;
+}
+
+void reset_extra(extra_t *extra)
+{
+   uint32_t i;
+
+   if (extra->kind == PORTS_ARRAY) {
+      for (i = 0; i < extra->ports_cnt; i ++) {
+         extra->ports[i].accesses = 0;
       }
-      if (extra != NULL) {
-         free(extra);
+   } else if (extra->kind == PORTS_HASH) {
+      for (i = 0; i < extra->slots_max; i ++) {
+         extra->slots[i].accesses = 0;
       }
-      return NULL;
+   } else {
+      memset(extra->counters, 0, ALL_PORTS * sizeof(uint32_t));
+   }
 }
 
-host_t *create_host(in_addr_t ip, params_t *params)
+host_t *create_host(arena_t *arena, matrix_t *matrix, in_addr_t ip, params_t *params)
 {
    host_t *host;
 
-   host = (host_t *) calloc(1, sizeof(host_t));
+   // Carving the host and its distances out of the arena, the memory is already zeroed.
+   host = (host_t *) alloc_arena(arena, sizeof(host_t));
    if (host == NULL) {
        fprintf(stderr, "%sNot enough memory for host structure.\n", ERROR);
-       goto error;
+       return NULL;
    }
    host->ip = ip;
    host->stat = 0;
    host->level = LEVEL_INFO;
    host->accesses = 1;
    host->distances = NULL;
-   host->intervals = NULL;
+   host->row = 0;
+   host->matrix = matrix;
+   host->seq = 0;
    host->extra = NULL;
 
    if ((params->mode & SYN_FLOODING) == SYN_FLOODING) {
-      host->distances = (double *) calloc(params->clusters, sizeof(double));
+      host->distances = (double *) alloc_arena(arena, params->clusters * sizeof(double));
       if (host->distances == NULL) {
           fprintf(stderr, "%sNot enough memory for host structure.\n", ERROR);
-          goto error;
+          return NULL;
       }
-      host->intervals = (intvl_t *) calloc(params->intvl_max, sizeof(intvl_t));
-      if (host->intervals == NULL) {
-          fprintf(stderr, "%sNot enough memory for host structure.\n", ERROR);
-          goto error;
+      if (add_row(matrix, &(host->row)) != EXIT_SUCCESS) {
+          return NULL;
       }
    }
    return host;
+}
 
-   error:
-      if (host->distances != NULL) {
-         free(host->distances);
-      }
-      if (host->intervals != NULL) {
-         free(host->intervals);
-      }
-      if (host != NULL) {
-         free(host);
-      }
-      return NULL;
+uint64_t hash_host(in_addr_t ip)
+{
+   return ((uint64_t) ip * 0x9e3779b97f4a7c15ULL) >> 32;
 }
 
-node_t *search_host(in_addr_t ip, node_t *root)
+int grow_hosts(graph_t *graph)
 {
-   int i;
-   uint32_t mask;
-   node_t *node, *tmp;
-
-   mask = MASK_IP4;
-   node = root;
-
-   for (i = 0; i < BITS_IP4; i ++) {
-      if (ip & mask) {
-         // Creating new node to the left.
-         if (node->left == NULL) {
-            tmp = (node_t *) calloc(1, sizeof(node_t));
-            if (tmp == NULL) {
-               fprintf(stderr, "%sNot enough memory for node structure.\n", ERROR);
-               return NULL;
-            }
-            node->left = tmp;
-            node = tmp;
-         }
-         // Continuing in binary tree.
-         else {
-            node = node->left;
+   uint64_t i, j, mask, slots_max;
+   slot_t *slots;
+
+   slots_max = graph->slots_max * 2;
+   slots = (slot_t *) calloc(slots_max, sizeof(slot_t));
+   if (slots == NULL) {
+      fprintf(stderr, "%sNot enough memory for hash table of hosts.\n", ERROR);
+      return EXIT_FAILURE;
+   }
+
+   // Inserting all hosts into the larger table.
+   mask = slots_max - 1;
+   for (i = 0; i < graph->slots_max; i ++) {
+      if (graph->slots[i].host != NULL) {
+         j = hash_host(graph->slots[i].ip) & mask;
+         while (slots[j].host != NULL) {
+            j = (j + 1) & mask;
          }
+         slots[j] = graph->slots[i];
       }
+   }
 
-      else {
-         // Creating new node to the right.
-         if (node->right == NULL) {
-            tmp = (node_t *) calloc(1, sizeof(node_t));
-            if (tmp == NULL) {
-               fprintf(stderr, "%sNot enough memory for node structure.\n", ERROR);
-               return NULL;
-            }
-            node->right = tmp;
-            node = tmp;
-         }
-         // Continuing in binary tree.
-         else {
-            node = node->right;
-         }
-      }
+   free(graph->slots);
+   graph->slots = slots;
+   graph->slots_max = slots_max;
+   return EXIT_SUCCESS;
+}
+
+slot_t *search_host(graph_t *graph, in_addr_t ip)
+{
+   uint64_t i, mask;
 
-      // Pushing one bit to the left.
-      ip <<= 1;
+   // Keeping the load factor under one half for short probe sequences.
+   if ((graph->hosts_cnt + 1) * 2 > graph->slots_max && grow_hosts(graph) != EXIT_SUCCESS) {
+      return NULL;
    }
 
-   return node;
+   mask = graph->slots_max - 1;
+   i = hash_host(ip) & mask;
+   while (graph->slots[i].host != NULL && graph->slots[i].ip != ip) {
+      i = (i + 1) & mask;
+   }
+   graph->slots[i].ip = ip;
+   return &(graph->slots[i]);
 }
 
-void free_host(node_t *node)
+void sync_host(graph_t *graph, host_t *host)
 {
-   // Deleting siblings to the left if exist.
-   if (node->left != NULL) {
-      free_host(node->left);
-   }
+   int col, intvl_max;
+   uint32_t e, first;
 
-   // Deleting siblings to the right if exist.
-   if (node->right != NULL) {
-      free_host(node->right);
+   if (host->epoch == graph->epoch) {
+      return;
    }
 
-   // Deleting host structure if exists.
-   if (node->val != NULL) {
-      host_t *host = (host_t *) node->val;
-      if (host->intervals != NULL) {
-         free(host->intervals);
-      }
-      if (host->distances != NULL) {
-         free(host->distances);
+   // Clearing columns of SYN matrix cleared by resets since the host was accessed.
+   intvl_max = graph->params->intvl_max;
+   if (host->matrix != NULL && graph->epoch_clear <= graph->epoch) {
+      first = (host->epoch + 1 > graph->epoch_clear) ? host->epoch + 1 : graph->epoch_clear;
+      if (graph->epoch - first + 1 >= (uint32_t) intvl_max) {
+         first = graph->epoch - intvl_max + 1;
       }
-      if (host->extra != NULL) {
-         if (host->extra->root != NULL) {
-            free_port(host->extra->root);
-         }
-         if (host->extra->ports != NULL) {
-            free(host->extra->ports);
-         }
-         free(host->extra);
+      for (e = first; e <= graph->epoch; e ++) {
+         col = (graph->column + intvl_max - (graph->epoch - e) % intvl_max) % intvl_max;
+         syn(host, col) = 0;
       }
-      free(host);
    }
+   host->epoch = graph->epoch;
+}
 
-   // Deleting current node.
-   free(node);
+void free_host(host_t *host)
+{
+   if (host->extra != NULL) {
+      free_extra(host->extra);
+      host->extra = NULL;
+   }
 }
 
 host_t **add_host(host_t **hosts, host_t *host, uint64_t *hosts_cnt, uint64_t *hosts_max)
 {
-   // Reallocating array if needed.
+   uint64_t max;
+   host_t **tmp;
+
+   // Reallocating array if needed, the original array is kept on failure.
    if (*hosts_cnt == *hosts_max) {
-      *hosts_max *= 2;
-      if (*hosts_max == 0) {
+      max = *hosts_max * 2;
+      if (max == 0) {
          fprintf(stderr, "%sToo many hosts in graph, next time it might overflow.\n", WARNING);
-         *hosts_max -= 1;
+         max -= 1;
       }
-      host_t **tmp = (host_t **) realloc(hosts, (*hosts_max) * sizeof(host_t *));
+      tmp = (host_t **) realloc(hosts, max * sizeof(host_t *));
       if (tmp == NULL) {
          fprintf(stderr, "%sNot enough memory for hosts array.\n", ERROR);
-         free(hosts);
          return NULL;
       }
       hosts = tmp;
+      *hosts_max = max;
    }
 
    // Adding new host to array of hosts and updating counter.
@@ -324,40 +498,69 @@ graph_t *get_host(graph_t *graph, flow_t *flow)
    int cnt, i, seconds;
    float pps;
    time_t diff;
-   node_t *node;
-   host_t *host;
-   port_t *port;
+   uint32_t *entry;
+   slot_t *slot;
+   host_t *host, **hosts;
 
    if (graph->params->mode == SYN_FLOODING && flow->syn_flag != 1) {
       // SYN flag is not set, skipping line.
       return graph;
    }
 
-   // Finding host with destination IP address.
-   node = search_host(flow->dst_ip, graph->root);
+   // Finding host with destination IP address, monitored prefixes are looked up directly.
+   entry = NULL;
+   slot = NULL;
+   if (graph->directory != NULL) {
+      entry = search_directory(graph->directory, flow->dst_ip);
+   }
+   if (entry != NULL) {
+      host = (*entry != 0) ? graph->hosts[*entry - 1] : NULL;
+   } else {
+      slot = search_host(graph, flow->dst_ip);
+      if (slot == NULL) {
+         goto error;
+      }
+      host = slot->host;
+   }
 
    // Creating new host with destination address if not present.
-   if (node->val == NULL) {
-      host = create_host(flow->dst_ip, graph->params);
+   if (host == NULL) {
+      host = create_host(graph->arena, graph->matrix, flow->dst_ip, graph->params);
       if (host == NULL) {
          goto error;
       }
-      node->val = host;
-      graph->hosts = add_host(graph->hosts, host, &(graph->hosts_cnt), &(graph->hosts_max));
-      if (graph->hosts == NULL) {
+      hosts = add_host(graph->hosts, host, &(graph->hosts_cnt), &(graph->hosts_max));
+      if (hosts == NULL) {
          goto error;
       }
+      graph->hosts = hosts;
+      if (entry != NULL) {
+         *entry = (uint32_t) graph->hosts_cnt;
+      } else {
+         slot->host = host;
+      }
+      host->epoch = graph->epoch;
    } else {
-      host = (host_t *) node->val;
+      sync_host(graph, host);
       host->accesses ++;
    }
 
+   // Listing host to be reset at the end of the interval.
+   if (host->listed == 0) {
+      hosts = add_host(graph->active, host, &(graph->active_cnt), &(graph->active_max));
+      if (hosts == NULL) {
+         goto error;
+      }
+      graph->active = hosts;
+      host->listed = 1;
+   }
+
    // Completing data of ports.
    if (((graph->params->mode & SYN_FLOODING) == SYN_FLOODING) && (flow->syn_flag == 1)) {
       host->stat = 1;
       // Adding all SYN packets in the same interval.
       if (flow->time_last < graph->interval_last) {
-         host->intervals[graph->interval_idx].syn_packets += flow->packets;
+         syn(host, graph->interval_idx) += flow->packets;
       }
 
       // Distributing SYN packets among various intervals using linear function.
@@ -367,49 +570,37 @@ graph_t *get_host(graph_t *graph, flow_t *flow)
 
          // Calculating the seconds residue of the intervals.
          seconds = graph->interval_last - flow->time_first;
-         host->intervals[graph->interval_idx].syn_packets += (seconds * pps);
+         syn(host, graph->interval_idx) += (seconds * pps);
          seconds = diff - seconds;
          if (seconds <= graph->params->interval) {
-            host->intervals[(graph->interval_idx+1)%graph->params->intvl_max].syn_packets += (seconds * pps);
+            syn(host, (graph->interval_idx+1)%graph->params->intvl_max) += (seconds * pps);
          }
          else {
+            // Spans longer than all the columns are cut, each column is filled once.
             cnt = seconds / graph->params->interval;
+            if (cnt >= graph->params->intvl_max) {
+               cnt = graph->params->intvl_max;
+            }
             for (i = 0; i < cnt; i ++) {
-               host->intervals[(graph->interval_idx+i+1)%graph->params->intvl_max].syn_packets += (graph->params->interval * pps);
+               syn(host, (graph->interval_idx+i+1)%graph->params->intvl_max) += (graph->params->interval * pps);
+            }
+            if (cnt < graph->params->intvl_max) {
+               syn(host, (graph->interval_idx+cnt+1)%graph->params->intvl_max) += ((seconds % graph->params->interval) * pps);
             }
-            host->intervals[(graph->interval_idx+cnt+1)%graph->params->intvl_max].syn_packets += ((seconds % graph->params->interval) * pps);
          }
       }
    }
 
-   // Completing data of ports.
-   if (((graph->params->mode & VER_PORTSCAN) == VER_PORTSCAN) || ((graph->params->mode & HOR_PORTSCAN) == HOR_PORTSCAN)) {
-      // Adding simple information about port scan attacks.
-      graph->ports[flow->dst_port].accesses ++;
-   }
-
    // Adding additional information about host.
-   if (host->stat == LEVEL_TRACE) {
-      // Finding port with destination port number.
-      node = search_port(flow->dst_port, host->extra->root);
-
-      // Creating new port with destination port number if not present.
-      if (node->val == NULL) {
-         port = (port_t *) calloc(1, sizeof(port_t));
-         if (port == NULL) {
-            fprintf(stderr, "%sNot enough memory for port structure.\n", ERROR);
+   if (host->level == LEVEL_TRACE) {
+      if (host->extra == NULL) {
+         host->extra = create_extra();
+         if (host->extra == NULL) {
             goto error;
          }
-         node->val = port;
-         port->port_num = flow->dst_port;
-         port->accesses = 1;
-         host->extra->ports = add_port(host->extra->ports, port, &(host->extra->ports_cnt), &(host->extra->ports_max));
-         if (host->extra->ports == NULL) {
-            goto error;
-         }
-      } else {
-         port = (port_t *) node->val;
-         port->accesses ++;
+      }
+      if (add_access(host->extra, flow->dst_port) != EXIT_SUCCESS) {
+         goto error;
       }
    }
 
@@ -435,6 +626,8 @@ int compare_host(const void *elem1, const void *elem2)
 void print_host(graph_t *graph, int idx, int mode)
 {
    int i, pid, status;
+   uint32_t pos;
+   port_t port;
    char buffer[BUFFER_TMP], dir[BUFFER_TMP], ip[INET_ADDRSTRLEN];
    struct tm *time;
    struct stat st;
@@ -473,11 +666,11 @@ void print_host(graph_t *graph, int idx, int mode)
       // Storing SYN flooding data.
       if (graph->window_cnt == 0) {
          for (i = 0; i < graph->interval_idx; i ++) {
-            fprintf(f, "%d %.0lf\n", i, graph->hosts[idx]->intervals[i].syn_packets);
+            fprintf(f, "%d %.0lf\n", i, syn(graph->hosts[idx], i));
          }
       } else {
          for (i = 0; i < (graph->params->intvl_max - ARRAY_EXTRA); i ++) {
-            fprintf(f, "%d %.0lf\n", i, graph->hosts[idx]->intervals[(graph->interval_idx+ARRAY_EXTRA+i)%graph->params->intvl_max].syn_packets);
+            fprintf(f, "%d %.0lf\n", i, syn(graph->hosts[idx], (graph->interval_idx+ARRAY_EXTRA+i)%graph->params->intvl_max));
          }
       }
       fclose(f);
@@ -510,7 +703,7 @@ void print_host(graph_t *graph, int idx, int mode)
       }
       fclose(f);
 
-      fprintf(g, "set title \"Number of ports used: %d\\nTime first: %s\"\n"
+      fprintf(g, "set title \"Number of ports used: %u\\nTime first: %s\"\n"
                  "set xlabel \"Destination port\"\n"
                  "set xrange [0:%d]\n"
                  "set yrange [0:]\n"
@@ -525,9 +718,9 @@ void print_host(graph_t *graph, int idx, int mode)
 
    else if (mode == HOR_PORTSCAN) {
       // Storing port scan data.
-      for (i = 0; i < TOP_ACCESSED; i ++) {
-         if (graph->ports[i].accesses > 0) {
-            fprintf(f, "%d %u\n", graph->ports[i].port_num, graph->ports[i].accesses);
+      for (i = 0; i < graph->top_cnt; i ++) {
+         if (graph->ports[graph->top[i]].accesses > 0) {
+            fprintf(f, "%d %u\n", graph->ports[graph->top[i]].port_num, graph->ports[graph->top[i]].accesses);
          }
       }
       fclose(f);
@@ -547,9 +740,10 @@ void print_host(graph_t *graph, int idx, int mode)
 
    else if (mode == ALL_ATTACKS) {
       // Storing vertical port scan data.
-      for (i = 0; i < graph->hosts[idx]->extra->ports_cnt; i ++) {
-         if (graph->hosts[idx]->extra->ports[i]->accesses > 0) {
-            fprintf(f, "%d %u\n", graph->hosts[idx]->extra->ports[i]->port_num, graph->hosts[idx]->extra->ports[i]->accesses);
+      pos = 0;
+      while (graph->hosts[idx]->extra != NULL && next_port(graph->hosts[idx]->extra, &pos, &port)) {
+         if (port.accesses > 0) {
+            fprintf(f, "%d %u\n", port.port_num, port.accesses);
          }
       }
       fclose(f);
@@ -572,6 +766,8 @@ void print_host(graph_t *graph, int idx, int mode)
       if ((execl("/usr/bin/gnuplot", "gnuplot", GNUPLOT, NULL)) < 0) {
          fprintf(stderr, "%sCannot run gnuplot, plot omitted.\n", WARNING);
       }
+      // Leaving the child, otherwise it would continue the detection.
+      _exit(EXIT_FAILURE);
    }
 
    // Error while forking the process
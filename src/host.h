@@ -13,91 +13,187 @@
 
 #include "main.h"
 #include "graph.h"
+#include "directory.h"
+#include "arena.h"
+#include "matrix.h"
+
+/*!
+ * \name Host macros.
+ * Defines macros comparing ports by number of accesses in the interval
+ * and accessing SYN packets of a host in its own matrix.
+ * \{ */
+#define ahead(graph, a, b) ((graph)->ports[a].accesses > (graph)->ports[b].accesses || \
+   ((graph)->ports[a].accesses == (graph)->ports[b].accesses && (a) < (b))) /*!< Port a is more accessed than port b. */
+#define syn(host, col) cell((host)->matrix, (host)->row, col) /*!< Number of SYN packets of the host in the interval. */
+/*! \} */
 
 /*!
  * \brief Reseting ports function
- * Function to reset port array of structures after the array has been sorted.
+ * Function to initialize port array of structures indexed by port number.
  * \param[in,out] ports Pointer to existing port array of structures.
  */
 void reset_port(port_t ports[ALL_PORTS]);
 
 /*!
- * \brief Creating network port function.
- * Function to create or search network port node in binary tree.
- * \param[in] port Network port to add into binary tree.
- * \param[in] root Root of port binary tree.
- * \return Pointer to belonging node on success, otherwise NULL.
- */
-node_t *search_port(uint16_t port, node_t *root);
-
-/*!
- * \brief Cleaning function.
- * Function to free all allocated memory for binary tree structure
- * using recursion. At the end, it also free all associated port structure.
- * \param[in] node Node in binary tree to be freed.
+ * \brief Updating top ports function.
+ * Function to keep the most accessed ports in descending order of accesses,
+ * ties in ascending order of port numbers, after the access of the port.
+ * Accesses grow by one, so the port can only overtake its neighbours.
+ * \param[in] graph Pointer to existing graph structure.
+ * \param[in] port Destination port number just accessed.
  */
-void free_port(node_t *node);
+void update_top(graph_t *graph, uint16_t port);
 
 /*!
- * \brief Adding port function.
- * Function to add port to array of ports.
- * It also reallocates the array if needed.
- * \param[in,out] ports Array of pointers to the ports.
- * \param[in] port Pointer to structure to be added to the array.
- * \param[in,out] ports_cnt Number of ports in the array.
- * \param[in,out] ports_max Maximum number of ports in the array.
- * \return Pointer to array of ports on success, otherwise NULL.
+ * \brief Counting port function.
+ * Function to count access to the destination port of a flow record in the interval,
+ * the number of used ports, the most accessed ports and the maximum of not well-known
+ * ports are updated.
+ * \param[in] graph Pointer to existing graph structure.
+ * \param[in] port Destination port number.
  */
-port_t **add_port(port_t **ports, port_t *port, uint16_t *ports_cnt, uint16_t *ports_max);
+void count_port(graph_t *graph, uint16_t port);
 
 /*!
- * \brief Comparing function.
- * Function to compare two port structures based on times of accesses.
- * \param[in] elem1 Pointer to the first element to be compared.
- * \param[in] elem2 Pointer to the second element to be compared.
- * \return Number indicating greater, equal or less sign.
+ * \brief Filling top ports function.
+ * Function to complete the most accessed ports with not accessed ports
+ * if less ports have been accessed in the interval.
+ * \param[in] graph Pointer to existing graph structure.
  */
-int compare_port(const void *elem1, const void *elem2);
+void fill_top(graph_t *graph);
 
 /*!
- \brief Allocating extra function
+ * \brief Allocating extra function
  * Function to allocate new extra information structure to a given host
  * and return a pointer to the allocated structure.
  * \return Pointer to newly created structure, otherwise NULL.
  */
 extra_t *create_extra();
 
+/*!
+ * \brief Deallocating extra function.
+ * Function to free extra information structure with its container of ports.
+ * \param[in] extra Pointer to existing extra structure.
+ */
+void free_extra(extra_t *extra);
+
+/*!
+ * \brief Copying extra function.
+ * Function to allocate a deep copy of extra information structure
+ * including its container of ports.
+ * \param[in] extra Pointer to existing extra structure.
+ * \return Pointer to newly created copy, otherwise NULL.
+ */
+extra_t *copy_extra(const extra_t *extra);
+
+/*!
+ * \brief Searching port function.
+ * Function to find slot of the port in hash table of ports using linear probing.
+ * \param[in] slots Hash table of ports.
+ * \param[in] slots_max Size of the hash table, a power of two.
+ * \param[in] port Destination port number.
+ * \return Pointer to slot of the port, empty if the port is not present.
+ */
+port_slot_t *search_slot(port_slot_t *slots, uint32_t slots_max, uint16_t port);
+
+/*!
+ * \brief Growing ports function.
+ * Function to move ports into larger container, inline array into hash table,
+ * hash table into twice larger one or into bitmap if it would exceed its maximum.
+ * \param[in] extra Pointer to existing extra structure.
+ * \return EXIT_SUCCESS on success, otherwise EXIT_FAILURE.
+ */
+int grow_ports(extra_t *extra);
+
+/*!
+ * \brief Adding access function.
+ * Function to count access to the port of a host, the container of ports
+ * is grown when full.
+ * \param[in] extra Pointer to existing extra structure.
+ * \param[in] port Destination port number.
+ * \return EXIT_SUCCESS on success, otherwise EXIT_FAILURE.
+ */
+int add_access(extra_t *extra, uint16_t port);
+
+/*!
+ * \brief Iterating ports function.
+ * Function to get the next used port of a host regardless of the kind of container.
+ * \param[in] extra Pointer to existing extra structure.
+ * \param[in,out] pos Position in the container, 0 to start from the beginning.
+ * \param[out] port Port number with number of accesses.
+ * \return 1 if a port has been found, 0 at the end of the container.
+ */
+int next_port(const extra_t *extra, uint32_t *pos, port_t *port);
+
+/*!
+ * \brief Reseting extra function.
+ * Function to zero accesses of all used ports of a host, the ports stay used.
+ * \param[in] extra Pointer to existing extra structure.
+ */
+void reset_extra(extra_t *extra);
+
 /*!
  * \brief Allocating host function.
  * Function to allocate new host to graph structure and return a pointer
- * to newly created host.
+ * to newly created host. The host and its distances are carved out of the arena
+ * of the graph, so they are freed together with the graph. SYN packets of the
+ * host are stored in a new row of the matrix of the graph, the host keeps
+ * the matrix to be clustered together with hosts of other shards.
+ * \param[in] arena Pointer to arena of the graph.
+ * \param[in] matrix Pointer to SYN matrix of the graph.
  * \param[in] ip IP address of new the host.
  * \param[in] params Pointer to structure with all initialized parameters.
  * \return Pointer to newly created host, otherwise NULL.
  */
-host_t *create_host(in_addr_t ip, params_t *params);
+host_t *create_host(arena_t *arena, matrix_t *matrix, in_addr_t ip, params_t *params);
+
+/*!
+ * \brief Hashing function.
+ * Function to compute hash of IPv4 address by Fibonacci hashing.
+ * \param[in] ip IPv4 address of the host.
+ * \return Hash of the address.
+ */
+uint64_t hash_host(in_addr_t ip);
+
+/*!
+ * \brief Growing hosts function.
+ * Function to double the hash table of hosts and insert all hosts again.
+ * \param[in] graph Pointer to existing graph structure.
+ * \return EXIT_SUCCESS on success, otherwise EXIT_FAILURE.
+ */
+int grow_hosts(graph_t *graph);
 
 /*!
- * \brief Creating IPv4 host function.
- * Function to create or search IPv4 address node in binary tree.
- * \param[in] ip IPv4 address to add into binary tree.
- * \param[in] root Root of IPv4 binary tree.
- * \return Pointer to belonging node on success, otherwise NULL.
+ * \brief Searching IPv4 host function.
+ * Function to find or insert IPv4 address in the hash table of hosts with
+ * linear probing. The table is grown to keep the load factor under one half.
+ * \param[in] graph Pointer to existing graph structure.
+ * \param[in] ip IPv4 address of the host.
+ * \return Pointer to belonging slot on success with empty host if not present, otherwise NULL.
+ */
+slot_t *search_host(graph_t *graph, in_addr_t ip);
+
+/*!
+ * \brief Synchronizing host function.
+ * Function to apply resets of SYN packets of the host postponed since the host
+ * was accessed the last time, columns cleared meanwhile are cleared in its row.
+ * \param[in] graph Pointer to existing graph structure.
+ * \param[in] host Pointer to host structure.
  */
-node_t *search_host(in_addr_t ip, node_t *root);
+void sync_host(graph_t *graph, host_t *host);
 
 /*!
- * \brief Cleaning function.
- * Function to free all allocated memory for binary tree structure
- * using recursion. At the end, it also free all associated host structure.
- * \param[in] node Node in binary tree to be freed.
+ * \brief Deallocating host function.
+ * Function to free extra information of the host, the host itself is freed
+ * with the arena of the graph.
+ * \param[in] host Pointer to host structure to be freed.
  */
-void free_host(node_t *node);
+void free_host(host_t *host);
 
 /*!
  * \brief Adding host function.
- * Function to add host to array of hosts.
- * It also reallocates the array if needed.
+ * Function to add host to array of hosts owning the hosts.
+ * It also reallocates the array if needed, the array is left untouched on failure.
  * \param[in,out] hosts Array of pointers to the hosts.
  * \param[in] host Pointer to structure to be added to the array.
  * \param[in,out] hosts_cnt Number of hosts in the array.
@@ -109,7 +205,9 @@ host_t **add_host(host_t **hosts, host_t *host, uint64_t *hosts_cnt, uint64_t *h
 /*!
  * \brief Adding host function
  * Function to add given flow record to graph of hosts based on given
- * destination IP address as the main identifier.
+ * destination IP address as the main identifier. Hosts in monitored prefixes
+ * are found in the host directory, other hosts in the hash table. Ports are
+ * counted separately by counting port function.
  * \param[in] flow Pointer to flow record structure.
  * \param[in] graph Pointer to existing graph structure.
  * \return Pointer to graph structure on success, otherwise NULL.
@@ -59,8 +59,11 @@ int main(int argc, char **argv)
       goto cleanup;
    }
 
+   // Selecting vectorized kernels supported by the processor.
+   simd_init();
+
    // Running the help mode, end of program.
-   if (params->file == NULL) {
+   if (params->file == NULL && params->port == 0) {
       goto cleanup; 
    }
 
@@ -48,12 +48,19 @@
 #include <stdlib.h>
 #include <string.h>
 #include <stdint.h>
+#include <errno.h>
 #include <math.h>
 #include <time.h>
 #include <getopt.h>
 #include <netdb.h>
+#include <pthread.h>
+#include <sched.h>
+#include <signal.h>
+#include <fcntl.h>
 #include <unistd.h>
 #include <arpa/inet.h>
+#include <sys/mman.h>
+#include <sys/socket.h>
 #include <sys/stat.h>
 #include <sys/types.h>
 #include <sys/wait.h>
@@ -71,12 +78,31 @@
 
 #define PROTOCOL_TCP 6 /*!< TCP protocol number. */
 #define PROTOCOL_UDP 17 /*!< UDP protocol number. */
+#define TCP_FIN 0x01 /*!< FIN bit of TCP flags. */
+#define TCP_SYN 0x02 /*!< SYN bit of TCP flags. */
+#define TCP_RST 0x04 /*!< RST bit of TCP flags. */
+#define TCP_ACK 0x10 /*!< ACK bit of TCP flags. */
 
 #define BUFFER_TMP 256 /*!< Size of a temporary buffer. */
 #define BUFFER_SIZE 8192 /*!< Size of a buffer for reading standard input. */
+#define STDIN_FILE "-" /*!< File name used for reading flows from standard input. */
+#define RANGE_LEN 32 /*!< Maximal length of time range parameter. */
+#define CHUNK_SIZE 4194304 /*!< Size of a file chunk parsed by a single thread. */
+#define CHUNK_DEPTH 2 /*!< Number of chunks per thread being parsed or waiting for the graph. */
+#define FLOWS_INIT 65536 /*!< Init size of array with flow records parsed from a chunk. */
+#define THREADS 1 /*!< Default number of parsing threads. */
+#define THREADS_MAX 64 /*!< Maximum number of parsing threads. */
+#define SHARDS 0 /*!< Default number of shards, hosts are aggregated by the main thread. */
+#define REORDER_WINDOW 0 /*!< Default reorder window of late flow records in seconds. */
+#define REORDER_SIZE 262144 /*!< Maximum number of flow records held in the reorder buffer. */
 
-#define PORTS_INIT 8 /*!< Init size of array with network ports. */
+#define PORTS_INLINE 8 /*!< Number of ports of a host kept in sorted inline array. */
+#define PORTS_HASH_INIT 32 /*!< Init size of hash table with ports of a host, a power of two. */
+#define PORTS_HASH_MAX 8192 /*!< Maximum size of hash table with ports of a host before switching to bitmap. */
 #define HOSTS_INIT 32768 /*!< Init size of array with hosts. */
+#define SLOTS_INIT 65536 /*!< Init size of hash table with hosts, a power of two. */
+#define PREFIXES_MAX 64 /*!< Maximum number of monitored prefixes. */
+#define PREFIX_MIN 8 /*!< Minimum length of monitored prefix. */
 
 #define VERTICAL_THRESHOLD 8192 /*!< Default threshold for vertical port scan attack. */
 #define HORIZONTAL_THRESHOLD 4096 /*!< Default threshold for horizontal port scan attack. */
@@ -85,8 +111,6 @@
 
 #define BITS_PORT 16 /*!< Number of bits in network port. */
 #define MASK_PORT 0x8000 /*!< Mask number for network port. */
-#define BITS_IP4 32 /*!< Number of bits in IPv4 address. */
-#define MASK_IP4 0x80000000 /*!< Mask number for 32 bit address. */
 
 #define FLUSH_ITER 0 /*!< Default number of iteration after the graph is flushed. */
 #define ARRAY_MIN 32 /*!< Minimum number of intervals. */
@@ -97,10 +121,14 @@
 
 #define CLUSTERS 2 /*!< Default number of clusters to be used in k-means algorithm. */
 #define CLUSTERS_MAX 255 /*!< Maximum number of clusters to be used in k-means algorithm. */
+#define BATCH_SIZE 1024 /*!< Default number of hosts sampled in one step of mini-batch k-means. */
+#define BATCH_BUDGET 0 /*!< Default time budget of mini-batch k-means in milliseconds, half of the interval if zero. */
 #define SYN_THRESHOLD 512 /*!< Minimum number of SYN packets sent in the interval for SYN flooding attack. */
 #define MEAN_DEVIATION 4 /*!< Mulitplier of mean to be different from standard deviation. */
 #define OBSERVATIONS 1 /*!< Default minumum number of observations in the cluster. */
 #define square(x) ((x) * (x)) /*!< Square function used in k-means algorithm. */
+#define be16(p) ((uint16_t) (((const uint8_t *) (p))[0] << 8 | ((const uint8_t *) (p))[1])) /*!< Unaligned read of 16 bit number in network byte order. */
+#define be32(p) ((uint32_t) be16(p) << 16 | be16((const uint8_t *) (p) + 2)) /*!< Unaligned read of 32 bit number in network byte order. */
 
 #define INFO "\033[1mInfo: \033[0m" /*!< Text prefix for information level announcement. */
 #define WARNING "\033[1;31mWarning:  \033[0m" /*!< Text prefix for warning level announcement. */
@@ -110,7 +138,7 @@
 #define TIME_FORMAT "%a %b %d %Y %H:%M:%S" /*!< Default human readable time format. */
 #define DATA_FILE "/tmp/data.txt" /*!< Data file location used by gnuplot.*/
 #define GNUPLOT "/tmp/config.gpl" /*!< Gnuplot configuration file location.*/
-#define OPTIONS "d:e:f:hHk:L:p:t:w:" /*!< Options for for command line. */
+#define OPTIONS "a:A:b:B:cd:e:f:hHj:k:L:m:no:p:P:r:s:S:t:T:u:w:Wx:" /*!< Options for for command line. */
 /*! \} */
 
 /*!
@@ -124,6 +152,25 @@ enum attack_type {
    ALL_ATTACKS = 0x07, /*!< All attack types. */
 };
 
+/*!
+ * \brief Flow field enumeration.
+ * Order of the fields in a line of the flow records file.
+ */
+enum flow_field {
+   FIELD_DST_IP = 0, /*!< Destination IP address field. */
+   FIELD_SRC_IP = 1, /*!< Source IP address field. */
+   FIELD_DST_PORT = 2, /*!< Destination port field. */
+   FIELD_SRC_PORT = 3, /*!< Source port field. */
+   FIELD_PROTOCOL = 4, /*!< Used protocol field. */
+   FIELD_TIME_FIRST = 5, /*!< Timestamp of the first packet field. */
+   FIELD_UNKNOWN = 6, /*!< Unknown field, skipped. */
+   FIELD_TIME_LAST = 7, /*!< Timestamp of the last packet field. */
+   FIELD_BYTES = 8, /*!< Number of transmitted bytes field. */
+   FIELD_PACKETS = 9, /*!< Number of transmitted packets field. */
+   FIELD_SYN_FLAG = 10, /*!< SYN flag field. */
+   FIELDS = 11 /*!< Number of fields in a line. */
+};
+
 /*!
  * \brief Verbose level enumeration.
  * Verbose level for printing data graph structure.
@@ -142,20 +189,9 @@ enum verbose_level {
  */
 enum host_level {
     LEVEL_INFO = 1, /*!< Basic examination level to inspect only briefly the given host. */
-    LEVEL_TRACE = 2 /*!< Extra examination level to inspect also the ports of given host. */
+    LEVEL_TRACE = 2 /*!< Extra examination level to inspect also the ports of given host, no host is raised to it yet. */
 };
 
-/*!
- * \brief Binary tree structure.
- * Structure containing pointers to left and right whether the bit
- * is 0 or 1, leafs also contains pointer to host structure.
- */
-typedef struct node {
-   struct node *left; /*!< Pointer to another node if result is 1. */
-   struct node *right; /*!< Pointer to another node if result is 0. */
-   void *val; /*!< Pointer to value structure if node is a leaf. */
-} node_t;
-
 /*!
  * \brief Interval structure.
  * Structure of interval containing number of SYN packets in the given interval
@@ -177,16 +213,39 @@ typedef struct port {
     uint32_t accesses; /*!< Number of times the given address has been accessed. */
 } port_t;
 
+/*!
+ * \brief Port slot structure.
+ * Slot of open-addressing hash table with ports of a host.
+ */
+typedef struct port_slot {
+    uint32_t key; /*!< Destination port number increased by one, 0 if the slot is empty. */
+    uint32_t accesses; /*!< Number of times the given port has been accessed. */
+} port_slot_t;
+
+/*!
+ * \brief Port container enumeration.
+ * Kind of container with ports of a host, it grows with the number of ports.
+ */
+enum ports_kind {
+    PORTS_ARRAY = 0, /*!< Sorted inline array for a few ports. */
+    PORTS_HASH = 1, /*!< Open-addressing hash table for medium number of ports. */
+    PORTS_BITMAP = 2 /*!< Bitmap of all ports with array of counters for scanned hosts. */
+};
+
 /*!
  * \brief Extra structure.
- * Extra host structure with additional information about the given host such as binary
- * tree of all ports that have been accessed.
+ * Extra host structure with additional information about the given host such as
+ * all ports that have been accessed, kept in a container adapted to their number.
+ * It is allocated only for hosts at the trace level.
  */
 typedef struct extra {
-   uint16_t ports_cnt; /*!< Number of different ports used to reach the given host. */
-   uint16_t ports_max; /*!< Number of different ports used to reach the given host. */
-   node_t *root; /*!< Pointer to root of binary tree with all network ports. */
-   port_t **ports; /*!< Pointer to array of used network ports structures. */
+   uint8_t kind; /*!< Kind of container with ports. */
+   uint32_t ports_cnt; /*!< Number of different ports used to reach the given host. */
+   uint32_t slots_max; /*!< Size of hash table with ports, a power of two. */
+   port_t ports[PORTS_INLINE]; /*!< Inline array of ports sorted by port number. */
+   port_slot_t *slots; /*!< Hash table of ports keyed by port number. */
+   uint64_t *bitmap; /*!< Bitmap of used ports. */
+   uint32_t *counters; /*!< Number of accesses indexed by port number. */
 } extra_t;
 
 /*!
@@ -212,14 +271,36 @@ typedef struct host {
    uint8_t level; /*!< Host examination level. */
    uint8_t cluster; /*!< Assigned cluster to the host. */
    uint8_t previous; /*!< Assigned cluster in the previous iteration. */
+   uint8_t listed; /*!< Flag of host in the list of hosts to be reset. */
+   uint32_t epoch; /*!< Number of the interval the host has been synchronized with. */
    uint32_t accesses; /*!< Number of times the given address has been accessed. */
    double peak; /*!< Maximum number of SYN packets in a interval sent to the host. */
    double mean; /*!< Average number of SYN packets sent to the host without the peak number. */
    double *distances; /*!< Distances to the centroids. */
-   intvl_t *intervals; /*!< Array of SYN packets number in the given interval. */
+   uint64_t row; /*!< Row of SYN packets numbers in observation intervals in the SYN matrix. */
+   struct matrix *matrix; /*!< SYN matrix containing the row of the host. */
+   uint64_t seq; /*!< Sequence number of the flow record which created the host. */
    extra_t *extra; /*!< Pointer to extra information about the host. */
 } host_t;
 
+/*!
+ * \brief Host slot structure.
+ * Slot of open-addressing hash table with hosts keyed by IPv4 address.
+ */
+typedef struct slot {
+   in_addr_t ip; /*!< IPv4 address of the host. */
+   host_t *host; /*!< Pointer to the host, NULL if the slot is empty. */
+} slot_t;
+
+/*!
+ * \brief Prefix structure.
+ * Monitored IPv4 network prefix.
+ */
+typedef struct prefix {
+   uint32_t net; /*!< Network address in host byte order. */
+   uint8_t len; /*!< Length of the prefix in bits. */
+} prefix_t;
+
 /*!
  * \brief Parameters structure.
  * Structure of parameters containing default or set parameters during initialization
@@ -239,8 +320,32 @@ typedef struct params {
    int window_sum; /*!< Number of reached windows during the runtime. */
    int ver_threshold; /*!< Threshold for vertical port scan attack. */
    int hor_threshold; /*!< Threshold for horizontal port scan attack. */
+   int threads; /*!< Number of threads parsing a mapped file. */
+   int shards; /*!< Number of shards aggregating hosts in worker threads. */
+   int window; /*!< Reorder window of late flow records in seconds. */
+   int port; /*!< UDP port receiving NetFlow and IPFIX packets. */
+   int netflow; /*!< Flag to decode NetFlow and IPFIX packets from capture file. */
+   int concurrent; /*!< Flag to run detection over a snapshot of the interval in a separate thread. */
+   int idle; /*!< Idle timeout of flows aggregated from packets in seconds. */
+   int active; /*!< Active timeout of flows aggregated from packets in seconds. */
+   int layout; /*!< Layout of the matrix of SYN packets. */
+   int algorithm; /*!< Algorithm of k-means used by SYN flooding detection. */
+   int warm; /*!< Flag to start k-means from centroids of the previous interval. */
+   int seeding; /*!< Seeding of centroids used by k-means. */
+   int batch; /*!< Number of hosts sampled in one step of mini-batch k-means. */
+   int budget; /*!< Time budget of mini-batch k-means in milliseconds. */
+   int prefixes_cnt; /*!< Number of monitored prefixes. */
+   prefix_t prefixes[PREFIXES_MAX]; /*!< Monitored prefixes indexed by host directory. */
+   uint64_t flows_cnt; /*!< Number of processed flows during the runtime. */
    char *file; /*!< CSV file to be processed by the algorithm. */
    char *name; /*!< File name in time format. */
+   char *output; /*!< Binary file to store converted flow records. */
+   char *archive_file; /*!< Columnar archive file to store converted flow records. */
+   struct writer *writer; /*!< Writer of binary flow records used for the conversion. */
+   struct archive *archive; /*!< Writer of columnar archive used for the conversion. */
+   struct reorder *reorder; /*!< Buffer of flow records waiting to be sorted. */
+   time_t range_first; /*!< Beginning of the requested time range of flow records. */
+   time_t range_last; /*!< End of the requested time range of flow records. */
 } params_t;
 
 /*!
@@ -269,12 +374,23 @@ typedef struct graph {
    uint8_t attack; /*!< Flag to identify which attack appeared in the interval. */
    uint8_t host_level; /*!< Flag to identify host examination level. */
    uint8_t cluster_idx; /*!< Index of cluster with detected hosts. */
+   uint8_t warm; /*!< Flag of centroids converged in the previous interval without empty cluster. */
+   int iterations; /*!< Number of k-means iterations in the last detection. */
    uint16_t interval_idx; /*!< Index number of given interval. */
    uint64_t interval_cnt; /*!< Number of reached intervals. */
    uint16_t interval_max; /*!< Maximum size of SYN packets array. */
-   uint16_t ports_ver; /*!< Number of different ports used in the interval. */
+   uint32_t ports_ver; /*!< Number of different ports used in the interval, counted on the first access. */
    uint32_t ports_hor; /*!< Maximum number of accesses on a single port in the interval. */
+   uint32_t unknown_max; /*!< Maximum number of accesses on a single not well-known port in the interval. */
+   uint8_t top_cnt; /*!< Number of the most accessed ports. */
+   uint16_t top[TOP_ACCESSED]; /*!< The most accessed ports in the interval in descending order. */
+   uint64_t known[ALL_PORTS / 64]; /*!< Bitmap of well-known ports. */
    port_t ports[ALL_PORTS]; /*!< Array of all ports and number of accesses in the given interval. */
+   uint32_t touched_cnt; /*!< Number of ports accessed in the interval. */
+   uint16_t touched[ALL_PORTS]; /*!< Ports accessed in the interval to be reset. */
+   uint32_t epoch; /*!< Number of intervals sealed by reset of the graph. */
+   uint32_t epoch_clear; /*!< The first interval whose reset cleared SYN packets, UINT32_MAX if none yet. */
+   uint16_t column; /*!< Column of SYN matrix cleared by the last reset. */
    uint32_t window_cnt; /*!< Number of reached windows before flushing the graph. */
    time_t interval_first; /*!< Given Unix timestamp of the interval begging. */
    time_t interval_last; /*!< Calculated Unix timestamp of the interval end. */
@@ -283,9 +399,21 @@ typedef struct graph {
    uint64_t hosts_cnt; /*!< Number of hosts determined by destination IP address in graph. */
    uint64_t hosts_max; /*!< Maximum number of hosts in graph. */
    params_t *params; /*!< Pointer to structure with all initialized parameters. */
-   node_t *root; /*!< Pointer to root of binary tree with all IPv4 addresses. */
+   uint64_t slots_max; /*!< Size of hash table with hosts, a power of two. */
+   slot_t *slots; /*!< Hash table of hosts keyed by IPv4 address. */
+   struct directory *directory; /*!< Directory of hosts in monitored prefixes. */
+   struct arena *arena; /*!< Arena of hosts with their arrays freed at once. */
+   struct matrix *matrix; /*!< Matrix of SYN packets of hosts in observation intervals. */
    host_t **hosts; /*!< Pointer to array of host structures. */
+   uint64_t active_cnt; /*!< Number of hosts to be reset. */
+   uint64_t active_max; /*!< Maximum number of hosts to be reset. */
+   host_t **active; /*!< Array of hosts accessed since their last reset. */
    cluster_t **clusters; /*!< Pointer to array of cluster structures. */
+   struct shard *shards; /*!< Array of shards aggregating hosts in worker threads, NULL if not sharded. */
+   struct graph *snapshot; /*!< Graph frozen at the end of the interval for concurrent detection. */
+   host_t *copies; /*!< Copies of hosts owned by the snapshot. */
+   pthread_t detector; /*!< Thread running detection over the snapshot. */
+   int detecting; /*!< Flag of detection thread running over the snapshot. */
 } graph_t;
 
 /*!
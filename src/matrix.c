@@ -0,0 +1,95 @@
+/*!
+ * \file matrix.c
+ * \brief SYN matrix library.
+ * \author Jan Neuzil <neuzija1@fit.cvut.cz>
+ * \date 2014
+ */
+/*
+ * Copyright (C) 2014 ISEP
+ */
+
+#include "matrix.h"
+
+matrix_t *create_matrix(int cols, int layout)
+{
+   matrix_t *matrix;
+
+   matrix = (matrix_t *) calloc(1, sizeof(matrix_t));
+   if (matrix == NULL) {
+      fprintf(stderr, "%sNot enough memory for SYN matrix.\n", ERROR);
+      return NULL;
+   }
+   matrix->layout = layout;
+   matrix->cols = cols;
+   matrix->rows_cnt = 0;
+   matrix->rows_max = ROWS_INIT;
+   if (layout == LAYOUT_ROW) {
+      matrix->row_stride = cols;
+      matrix->col_stride = 1;
+   } else {
+      matrix->row_stride = 1;
+      matrix->col_stride = matrix->rows_max;
+   }
+
+   matrix->data = (double *) calloc(matrix->rows_max * cols, sizeof(double));
+   if (matrix->data == NULL) {
+      fprintf(stderr, "%sNot enough memory for SYN matrix.\n", ERROR);
+      free(matrix);
+      return NULL;
+   }
+   return matrix;
+}
+
+void free_matrix(matrix_t *matrix)
+{
+   if (matrix != NULL) {
+      free(matrix->data);
+      free(matrix);
+   }
+}
+
+int add_row(matrix_t *matrix, uint64_t *row)
+{
+   int i;
+   uint64_t rows_max;
+   double *data;
+
+   if (matrix->rows_cnt == matrix->rows_max) {
+      rows_max = matrix->rows_max * 2;
+      data = (double *) calloc(rows_max * matrix->cols, sizeof(double));
+      if (data == NULL) {
+         fprintf(stderr, "%sNot enough memory for SYN matrix.\n", ERROR);
+         return EXIT_FAILURE;
+      }
+
+      // Copying rows at once, or each column to its new position.
+      if (matrix->layout == LAYOUT_ROW) {
+         memcpy(data, matrix->data, matrix->rows_cnt * matrix->cols * sizeof(double));
+      } else {
+         for (i = 0; i < matrix->cols; i ++) {
+            memcpy(data + i * rows_max, matrix->data + i * matrix->rows_max, matrix->rows_cnt * sizeof(double));
+         }
+         matrix->col_stride = rows_max;
+      }
+      free(matrix->data);
+      matrix->data = data;
+      matrix->rows_max = rows_max;
+   }
+
+   *row = matrix->rows_cnt ++;
+   return EXIT_SUCCESS;
+}
+
+void clear_matrix(matrix_t *matrix)
+{
+   int i;
+
+   if (matrix->layout == LAYOUT_ROW) {
+      memset(matrix->data, 0, matrix->rows_cnt * matrix->cols * sizeof(double));
+   } else {
+      for (i = 0; i < matrix->cols; i ++) {
+         memset(&cell(matrix, 0, i), 0, matrix->rows_cnt * sizeof(double));
+      }
+   }
+   matrix->rows_cnt = 0;
+}
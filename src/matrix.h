@@ -0,0 +1,81 @@
+/*!
+ * \file matrix.h
+ * \brief Header file to SYN matrix library.
+ * \author Jan Neuzil <neuzija1@fit.cvut.cz>
+ * \date 2014
+ */
+/*
+ * Copyright (C) 2014 ISEP
+ */
+
+#ifndef _MATRIX_
+#define _MATRIX_
+
+#include "main.h"
+
+/*!
+ * \name Matrix values.
+ * Defines macros used by matrix of SYN packets of hosts in observation intervals.
+ * \{ */
+#define ROWS_INIT 32768 /*!< Init number of rows of the matrix. */
+#define cell(matrix, row, col) ((matrix)->data[(row) * (matrix)->row_stride + (col) * (matrix)->col_stride]) /*!< Number of SYN packets of the host in the interval. */
+/*! \} */
+
+/*!
+ * \brief Matrix layout enumeration.
+ * Order in which SYN packets of hosts in observation intervals are stored.
+ */
+enum matrix_layout {
+   LAYOUT_ROW = 0, /*!< Intervals of a host are contiguous. */
+   LAYOUT_COLUMN = 1 /*!< Hosts in an interval are contiguous. */
+};
+
+/*!
+ * \brief Matrix structure.
+ * Contiguous matrix of SYN packets with a row per host and a column per
+ * observation interval, strides map both layouts to the same indexing.
+ */
+typedef struct matrix {
+   int layout; /*!< Layout of the matrix. */
+   int cols; /*!< Number of columns, the size of the array of intervals. */
+   uint64_t rows_cnt; /*!< Number of used rows. */
+   uint64_t rows_max; /*!< Number of allocated rows. */
+   uint64_t row_stride; /*!< Distance between two rows in elements. */
+   uint64_t col_stride; /*!< Distance between two columns in elements. */
+   double *data; /*!< Elements of the matrix. */
+} matrix_t;
+
+/*!
+ * \brief Allocating matrix function.
+ * Function to allocate zeroed matrix of SYN packets.
+ * \param[in] cols Number of observation intervals.
+ * \param[in] layout Layout of the matrix.
+ * \return Pointer to newly created matrix, otherwise NULL.
+ */
+matrix_t *create_matrix(int cols, int layout);
+
+/*!
+ * \brief Deallocating matrix function.
+ * Function to free matrix of SYN packets.
+ * \param[in] matrix Pointer to existing matrix.
+ */
+void free_matrix(matrix_t *matrix);
+
+/*!
+ * \brief Adding row function.
+ * Function to add zeroed row for a new host, the matrix is grown twice if full.
+ * \param[in] matrix Pointer to existing matrix.
+ * \param[out] row Index of the added row.
+ * \return EXIT_SUCCESS on success, otherwise EXIT_FAILURE.
+ */
+int add_row(matrix_t *matrix, uint64_t *row);
+
+/*!
+ * \brief Clearing matrix function.
+ * Function to zero all used rows and drop them, allocated memory is kept
+ * for new rows.
+ * \param[in] matrix Pointer to existing matrix.
+ */
+void clear_matrix(matrix_t *matrix);
+
+#endif
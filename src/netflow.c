@@ -0,0 +1,393 @@
+/*!
+ * \file netflow.c
+ * \brief NetFlow and IPFIX decoder library.
+ * \author Jan Neuzil <neuzija1@fit.cvut.cz>
+ * \date 2014
+ */
+/*
+ * Copyright (C) 2014 ISEP
+ */
+
+#include "netflow.h"
+
+netflow_t *create_netflow(int window)
+{
+   netflow_t *netflow;
+
+   netflow = (netflow_t *) calloc(1, sizeof(netflow_t));
+   if (netflow == NULL) {
+      fprintf(stderr, "%sNot enough memory for NetFlow decoder.\n", ERROR);
+      return NULL;
+   }
+   netflow->window = window;
+   return netflow;
+}
+
+void free_netflow(netflow_t *netflow)
+{
+   free(netflow);
+}
+
+int netflow_check(const uint8_t *data, uint32_t len)
+{
+   uint16_t cnt;
+
+   if (len < SET_HEADER_LEN) {
+      return EXIT_FAILURE;
+   }
+   cnt = be16(data + 2);
+
+   switch (be16(data)) {
+      case NETFLOW_V5:
+         if (cnt > 0 && cnt <= V5_RECORDS_MAX && len >= V5_HEADER_LEN + (uint32_t) cnt * V5_RECORD_LEN) {
+            return EXIT_SUCCESS;
+         }
+         break;
+      case NETFLOW_V9:
+         if (len >= V9_HEADER_LEN) {
+            return EXIT_SUCCESS;
+         }
+         break;
+      case NETFLOW_IPFIX:
+         // IPFIX header carries length of the message instead of the number of records.
+         if (cnt >= IPFIX_HEADER_LEN && cnt <= len) {
+            return EXIT_SUCCESS;
+         }
+         break;
+      default:
+         break;
+   }
+   return EXIT_FAILURE;
+}
+
+int flow_check(netflow_t *netflow, const flow_t *flow)
+{
+   if (flow->time_last < flow->time_first || flow->time_last - flow->time_first > netflow->window) {
+      netflow->invalid_cnt ++;
+      return EXIT_FAILURE;
+   }
+   return EXIT_SUCCESS;
+}
+
+int decode_netflow(netflow_t *netflow, const uint8_t *data, uint32_t len, uint32_t source)
+{
+   int cnt;
+   uint16_t i, id, set_id;
+   uint32_t end, offset, set_len, uptime;
+   int64_t export_ms;
+   const uint8_t *record;
+   flow_t *flow;
+   template_t key, *template;
+
+   if (netflow_check(data, len) != EXIT_SUCCESS) {
+      netflow->invalid_cnt ++;
+      return -1;
+   }
+   netflow->packets_cnt ++;
+   cnt = 0;
+
+   // Decoding fixed records of NetFlow v5, times are relative to the system uptime.
+   if (be16(data) == NETFLOW_V5) {
+      uptime = be32(data + 4);
+      export_ms = (int64_t) be32(data + 8) * 1000 + be32(data + 12) / 1000000;
+      for (i = 0; i < be16(data + 2); i ++) {
+         record = data + V5_HEADER_LEN + i * V5_RECORD_LEN;
+         flow = &(netflow->flows[cnt ++]);
+         memcpy(&(flow->src_ip), record, sizeof(in_addr_t));
+         memcpy(&(flow->dst_ip), record + 4, sizeof(in_addr_t));
+         flow->packets = be32(record + 16);
+         flow->bytes = be32(record + 20);
+         flow->time_first = (export_ms - (int32_t) (uptime - be32(record + 24))) / 1000;
+         flow->time_last = (export_ms - (int32_t) (uptime - be32(record + 28))) / 1000;
+         flow->src_port = be16(record + 32);
+         flow->dst_port = be16(record + 34);
+         flow->protocol = record[38];
+         flow->syn_flag = (flow->protocol == PROTOCOL_TCP && (record[37] & TCP_SYN) != 0);
+
+         // Dropping records with impossible times.
+         if (flow_check(netflow, flow) != EXIT_SUCCESS) {
+            cnt --;
+         }
+      }
+      netflow->flows_cnt += cnt;
+      return cnt;
+   }
+
+   memset(&key, 0, sizeof(template_t));
+   key.source = source;
+   key.version = be16(data);
+   if (key.version == NETFLOW_V9) {
+      uptime = be32(data + 4);
+      export_ms = (int64_t) be32(data + 8) * 1000;
+      key.domain = be32(data + 16);
+      offset = V9_HEADER_LEN;
+      end = len;
+      set_id = V9_TEMPLATE_SET;
+   } else {
+      uptime = 0;
+      export_ms = (int64_t) be32(data + 4) * 1000;
+      key.domain = be32(data + 12);
+      offset = IPFIX_HEADER_LEN;
+      end = be16(data + 2);
+      set_id = IPFIX_TEMPLATE_SET;
+   }
+
+   // Decoding templates and data sets, options are not used by the detection.
+   while (offset + SET_HEADER_LEN <= end) {
+      id = be16(data + offset);
+      set_len = be16(data + offset + 2);
+      if (set_len < SET_HEADER_LEN || offset + set_len > end) {
+         netflow->invalid_cnt ++;
+         break;
+      }
+
+      if (id == set_id) {
+         if (decode_template(netflow, data + offset + SET_HEADER_LEN, set_len - SET_HEADER_LEN, &key) != EXIT_SUCCESS) {
+            netflow->invalid_cnt ++;
+         }
+      } else if (id >= DATA_SET_MIN) {
+         key.id = id;
+         template = find_template(netflow, &key);
+         if (template == NULL) {
+            netflow->missing_cnt ++;
+         } else {
+            cnt = decode_data(netflow, data + offset + SET_HEADER_LEN, set_len - SET_HEADER_LEN, template, export_ms, uptime, cnt);
+         }
+      }
+      offset += set_len;
+   }
+
+   netflow->flows_cnt += cnt;
+   return cnt;
+}
+
+template_t *find_template(netflow_t *netflow, const template_t *key)
+{
+   uint32_t i;
+   template_t *template;
+
+   for (i = 0; i < netflow->templates_cnt; i ++) {
+      template = &(netflow->templates[i]);
+      if (template->id == key->id && template->source == key->source &&
+          template->domain == key->domain && template->version == key->version) {
+         return template;
+      }
+   }
+   return NULL;
+}
+
+int decode_template(netflow_t *netflow, const uint8_t *data, uint32_t len, const template_t *key)
+{
+   uint16_t i, id, flen;
+   uint32_t offset;
+   template_t tmp, *template;
+
+   offset = 0;
+   while (offset + SET_HEADER_LEN <= len) {
+      tmp = *key;
+      tmp.id = be16(data + offset);
+      tmp.fields_cnt = be16(data + offset + 2);
+      tmp.min_len = 0;
+      offset += SET_HEADER_LEN;
+
+      // Skipping padding at the end of the set.
+      if (tmp.id == 0 && tmp.fields_cnt == 0) {
+         break;
+      }
+      if (tmp.id < DATA_SET_MIN || tmp.fields_cnt > TEMPLATE_FIELDS) {
+         return EXIT_FAILURE;
+      }
+      template = find_template(netflow, &tmp);
+
+      // Withdrawing template announced with no fields.
+      if (tmp.fields_cnt == 0) {
+         if (template != NULL) {
+            *template = netflow->templates[-- netflow->templates_cnt];
+         }
+         continue;
+      }
+
+      for (i = 0; i < tmp.fields_cnt; i ++) {
+         if (offset + SET_HEADER_LEN > len) {
+            return EXIT_FAILURE;
+         }
+         id = be16(data + offset);
+         flen = be16(data + offset + 2);
+         offset += SET_HEADER_LEN;
+
+         // Enterprise specific elements are skipped by the decoder.
+         if (key->version == NETFLOW_IPFIX && (id & ENTERPRISE_BIT) != 0) {
+            offset += sizeof(uint32_t);
+            id = 0;
+         }
+         tmp.fields[i].id = id;
+         tmp.fields[i].len = flen;
+         tmp.min_len += (flen == VARIABLE_LEN) ? 1 : flen;
+      }
+      if (offset > len || tmp.min_len == 0) {
+         return EXIT_FAILURE;
+      }
+
+      if (template == NULL) {
+         if (netflow->templates_cnt == TEMPLATES_MAX) {
+            fprintf(stderr, "%sToo many NetFlow templates, template %u skipped.\n", WARNING, tmp.id);
+            continue;
+         }
+         template = &(netflow->templates[netflow->templates_cnt ++]);
+      }
+      *template = tmp;
+   }
+   return EXIT_SUCCESS;
+}
+
+int decode_data(netflow_t *netflow, const uint8_t *data, uint32_t len, const template_t *template, int64_t export_ms, uint32_t uptime, int cnt)
+{
+   int addrs;
+   uint8_t tcp_flags;
+   uint16_t i, j, flen;
+   uint32_t offset;
+   uint64_t value;
+   int64_t first_ms, last_ms, first_up, last_up, init_ms;
+   const uint8_t *field;
+   flow_t *flow;
+
+   offset = 0;
+   while (offset + template->min_len <= len && cnt < NETFLOW_FLOWS) {
+      flow = &(netflow->flows[cnt]);
+      memset(flow, 0, sizeof(flow_t));
+      addrs = 0;
+      tcp_flags = 0;
+      first_ms = last_ms = first_up = last_up = init_ms = -1;
+
+      for (i = 0; i < template->fields_cnt; i ++) {
+         flen = template->fields[i].len;
+
+         // Reading length of IPFIX variable length field.
+         if (flen == VARIABLE_LEN) {
+            if (offset >= len) {
+               return cnt;
+            }
+            flen = data[offset ++];
+            if (flen == UINT8_MAX) {
+               if (offset + sizeof(uint16_t) > len) {
+                  return cnt;
+               }
+               flen = be16(data + offset);
+               offset += sizeof(uint16_t);
+            }
+         }
+         if (offset + flen > len) {
+            return cnt;
+         }
+         field = data + offset;
+         offset += flen;
+
+         // Only numbers and IPv4 addresses are used, reduced size encoding is allowed.
+         if (flen > sizeof(uint64_t)) {
+            continue;
+         }
+         value = 0;
+         for (j = 0; j < flen; j ++) {
+            value = (value << 8) | field[j];
+         }
+
+         switch (template->fields[i].id) {
+            case ELEM_BYTES:
+               flow->bytes = value;
+               break;
+            case ELEM_PACKETS:
+               flow->packets = value;
+               break;
+            case ELEM_PROTOCOL:
+               flow->protocol = value;
+               break;
+            case ELEM_TCP_FLAGS:
+               tcp_flags = value;
+               break;
+            case ELEM_SRC_PORT:
+               flow->src_port = value;
+               break;
+            case ELEM_DST_PORT:
+               flow->dst_port = value;
+               break;
+            case ELEM_SRC_IP:
+               if (flen == sizeof(in_addr_t)) {
+                  memcpy(&(flow->src_ip), field, sizeof(in_addr_t));
+                  addrs |= 0x01;
+               }
+               break;
+            case ELEM_DST_IP:
+               if (flen == sizeof(in_addr_t)) {
+                  memcpy(&(flow->dst_ip), field, sizeof(in_addr_t));
+                  addrs |= 0x02;
+               }
+               break;
+            case ELEM_FIRST_UPTIME:
+               first_up = value;
+               break;
+            case ELEM_LAST_UPTIME:
+               last_up = value;
+               break;
+            case ELEM_FIRST_SEC:
+               first_ms = value * 1000;
+               break;
+            case ELEM_LAST_SEC:
+               last_ms = value * 1000;
+               break;
+            case ELEM_FIRST_MSEC:
+               first_ms = value;
+               break;
+            case ELEM_LAST_MSEC:
+               last_ms = value;
+               break;
+            case ELEM_INIT_MSEC:
+               init_ms = value;
+               break;
+            default:
+               break;
+         }
+      }
+
+      // Skipping records without IPv4 addresses.
+      if (addrs != 0x03) {
+         continue;
+      }
+
+      // Converting times relative to the system uptime or init time.
+      if (first_ms < 0 && first_up >= 0) {
+         if (init_ms >= 0) {
+            first_ms = init_ms + first_up;
+         } else if (template->version == NETFLOW_V9) {
+            first_ms = export_ms - (int32_t) (uptime - (uint32_t) first_up);
+         }
+      }
+      if (last_ms < 0 && last_up >= 0) {
+         if (init_ms >= 0) {
+            last_ms = init_ms + last_up;
+         } else if (template->version == NETFLOW_V9) {
+            last_ms = export_ms - (int32_t) (uptime - (uint32_t) last_up);
+         }
+      }
+      if (first_ms < 0) {
+         first_ms = export_ms;
+      }
+      if (last_ms < 0) {
+         last_ms = first_ms;
+      }
+
+      flow->time_first = first_ms / 1000;
+      flow->time_last = last_ms / 1000;
+      flow->syn_flag = (flow->protocol == PROTOCOL_TCP && (tcp_flags & TCP_SYN) != 0);
+
+      // Dropping records with impossible times.
+      if (flow_check(netflow, flow) == EXIT_SUCCESS) {
+         cnt ++;
+      }
+   }
+
+   // Counting records which do not fit into the buffer, at most one per minimum length.
+   if (cnt == NETFLOW_FLOWS && offset + template->min_len <= len) {
+      netflow->dropped_cnt += (len - offset) / template->min_len;
+   }
+   return cnt;
+}
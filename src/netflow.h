@@ -0,0 +1,181 @@
+/*!
+ * \file netflow.h
+ * \brief Header file to NetFlow and IPFIX decoder library.
+ * \author Jan Neuzil <neuzija1@fit.cvut.cz>
+ * \date 2014
+ */
+/*
+ * Copyright (C) 2014 ISEP
+ */
+
+#ifndef _NETFLOW_
+#define _NETFLOW_
+
+#include "main.h"
+
+/*!
+ * \name NetFlow format values.
+ * Defines macros used by NetFlow v5, v9 and IPFIX export packets.
+ * \{ */
+#define NETFLOW_V5 5 /*!< Version number of NetFlow v5. */
+#define NETFLOW_V9 9 /*!< Version number of NetFlow v9. */
+#define NETFLOW_IPFIX 10 /*!< Version number of IPFIX. */
+#define NETFLOW_BUFFER 65536 /*!< Size of a buffer for receiving export packet. */
+#define NETFLOW_RCVBUF 8388608 /*!< Requested size of socket receive buffer. */
+#define NETFLOW_FLOWS 16384 /*!< Maximum number of flow records decoded from a packet. */
+
+#define V5_HEADER_LEN 24 /*!< Size of NetFlow v5 header. */
+#define V5_RECORD_LEN 48 /*!< Size of NetFlow v5 record. */
+#define V5_RECORDS_MAX 30 /*!< Maximum number of records in NetFlow v5 packet. */
+#define V9_HEADER_LEN 20 /*!< Size of NetFlow v9 header. */
+#define IPFIX_HEADER_LEN 16 /*!< Size of IPFIX header. */
+#define SET_HEADER_LEN 4 /*!< Size of flowset header. */
+
+#define V9_TEMPLATE_SET 0 /*!< NetFlow v9 template flowset identifier. */
+#define IPFIX_TEMPLATE_SET 2 /*!< IPFIX template set identifier. */
+#define DATA_SET_MIN 256 /*!< The lowest identifier of data set. */
+#define TEMPLATES_MAX 256 /*!< Maximum number of cached templates. */
+#define TEMPLATE_FIELDS 64 /*!< Maximum number of fields in a template. */
+#define VARIABLE_LEN 65535 /*!< Field length of IPFIX variable length field. */
+#define ENTERPRISE_BIT 0x8000 /*!< Enterprise bit of IPFIX field identifier. */
+
+#define ELEM_BYTES 1 /*!< Information element of transmitted bytes. */
+#define ELEM_PACKETS 2 /*!< Information element of transmitted packets. */
+#define ELEM_PROTOCOL 4 /*!< Information element of used protocol. */
+#define ELEM_TCP_FLAGS 6 /*!< Information element of TCP flags. */
+#define ELEM_SRC_PORT 7 /*!< Information element of source port. */
+#define ELEM_SRC_IP 8 /*!< Information element of source IPv4 address. */
+#define ELEM_DST_PORT 11 /*!< Information element of destination port. */
+#define ELEM_DST_IP 12 /*!< Information element of destination IPv4 address. */
+#define ELEM_LAST_UPTIME 21 /*!< Information element of the last packet in system uptime. */
+#define ELEM_FIRST_UPTIME 22 /*!< Information element of the first packet in system uptime. */
+#define ELEM_FIRST_SEC 150 /*!< Information element of the first packet in seconds. */
+#define ELEM_LAST_SEC 151 /*!< Information element of the last packet in seconds. */
+#define ELEM_FIRST_MSEC 152 /*!< Information element of the first packet in milliseconds. */
+#define ELEM_LAST_MSEC 153 /*!< Information element of the last packet in milliseconds. */
+#define ELEM_INIT_MSEC 160 /*!< Information element of the system init time in milliseconds. */
+/*! \} */
+
+/*!
+ * \brief Template field structure.
+ * Information element and its length in a data record.
+ */
+typedef struct template_field {
+   uint16_t id; /*!< Information element identifier, 0 for enterprise elements. */
+   uint16_t len; /*!< Length of the field in bytes. */
+} template_field_t;
+
+/*!
+ * \brief Template structure.
+ * Template of data records announced by an exporter, it is scoped by the exporter
+ * address, observation domain and export version.
+ */
+typedef struct template {
+   uint32_t source; /*!< Address of the exporter. */
+   uint32_t domain; /*!< Source identifier or observation domain. */
+   uint16_t version; /*!< Export version of the template. */
+   uint16_t id; /*!< Template identifier. */
+   uint16_t fields_cnt; /*!< Number of fields in a data record. */
+   uint32_t min_len; /*!< Minimum length of a data record. */
+   template_field_t fields[TEMPLATE_FIELDS]; /*!< Fields of a data record. */
+} template_t;
+
+/*!
+ * \brief NetFlow decoder structure.
+ * Decoder state with cached templates and buffer of decoded flow records.
+ */
+typedef struct netflow {
+   int window; /*!< The longest accepted span of a flow record in seconds. */
+   uint32_t templates_cnt; /*!< Number of cached templates. */
+   uint64_t packets_cnt; /*!< Number of decoded export packets. */
+   uint64_t invalid_cnt; /*!< Number of malformed export packets and flow records. */
+   uint64_t missing_cnt; /*!< Number of data sets without known template. */
+   uint64_t flows_cnt; /*!< Number of decoded flow records. */
+   uint64_t dropped_cnt; /*!< Number of flow records over the limit of a packet. */
+   template_t templates[TEMPLATES_MAX]; /*!< Cached templates. */
+   flow_t flows[NETFLOW_FLOWS]; /*!< Flow records decoded from the last packet. */
+} netflow_t;
+
+/*!
+ * \brief Allocating NetFlow function.
+ * Function to allocate NetFlow decoder with empty template cache.
+ * \param[in] window The longest accepted span of a flow record in seconds.
+ * \return Pointer to newly created decoder, otherwise NULL.
+ */
+netflow_t *create_netflow(int window);
+
+/*!
+ * \brief Deallocating NetFlow function.
+ * Function to free NetFlow decoder with all cached templates.
+ * \param[in] netflow Pointer to existing decoder.
+ */
+void free_netflow(netflow_t *netflow);
+
+/*!
+ * \brief Checking NetFlow function.
+ * Function to recognize NetFlow v5, v9 or IPFIX export packet by its header.
+ * \param[in] data Pointer to the export packet.
+ * \param[in] len Length of the export packet.
+ * \return EXIT_SUCCESS if the packet looks like export packet, otherwise EXIT_FAILURE.
+ */
+int netflow_check(const uint8_t *data, uint32_t len);
+
+/*!
+ * \brief Checking flow function.
+ * Function to validate times of a decoded flow record, records ending before
+ * they start or spanning more than the time window are counted as malformed.
+ * \param[in] netflow Pointer to existing decoder.
+ * \param[in] flow Pointer to the decoded flow record.
+ * \return EXIT_SUCCESS if the record is valid, otherwise EXIT_FAILURE.
+ */
+int flow_check(netflow_t *netflow, const flow_t *flow);
+
+/*!
+ * \brief Decoding NetFlow function.
+ * Function to decode export packet into flow records stored in the decoder.
+ * Templates are cached, data sets without known template are skipped as well
+ * as records without IPv4 addresses.
+ * \param[in] netflow Pointer to existing decoder.
+ * \param[in] data Pointer to the export packet.
+ * \param[in] len Length of the export packet.
+ * \param[in] source Address of the exporter.
+ * \return Number of decoded flow records, -1 if the packet is malformed.
+ */
+int decode_netflow(netflow_t *netflow, const uint8_t *data, uint32_t len, uint32_t source);
+
+/*!
+ * \brief Finding template function.
+ * Function to find cached template in the scope of given key.
+ * \param[in] netflow Pointer to existing decoder.
+ * \param[in] key Template with the exporter, domain, version and identifier.
+ * \return Pointer to cached template, NULL if it is unknown.
+ */
+template_t *find_template(netflow_t *netflow, const template_t *key);
+
+/*!
+ * \brief Decoding template function.
+ * Function to add, replace or withdraw templates announced in a template set.
+ * \param[in] netflow Pointer to existing decoder.
+ * \param[in] data Pointer to the content of template set.
+ * \param[in] len Length of the content.
+ * \param[in] key Template with the scope of the set, exporter, domain and version.
+ * \return EXIT_SUCCESS on success, otherwise EXIT_FAILURE.
+ */
+int decode_template(netflow_t *netflow, const uint8_t *data, uint32_t len, const template_t *key);
+
+/*!
+ * \brief Decoding data function.
+ * Function to decode data records of a data set by given template.
+ * \param[in] netflow Pointer to existing decoder.
+ * \param[in] data Pointer to the content of data set.
+ * \param[in] len Length of the content.
+ * \param[in] template Template of the data records.
+ * \param[in] export_ms Export time in milliseconds.
+ * \param[in] uptime System uptime of the exporter at the export in milliseconds, NetFlow v9 only.
+ * \param[in] cnt Number of already decoded flow records from the packet.
+ * \return Number of all decoded flow records from the packet, records over
+ * the limit of the decoder are counted as dropped.
+ */
+int decode_data(netflow_t *netflow, const uint8_t *data, uint32_t len, const template_t *template, int64_t export_ms, uint32_t uptime, int cnt);
+
+#endif
@@ -10,44 +10,45 @@
 
 #include "parser.h"
 
-static uint16_t known_ports[KNOWN_PORTS] = {
-   20, // FTP
-   21, // FTP
-   22, // SSH
-   23, // Telnet
-   25, // SMTP
-   53, // DNS
-   80, // HTTP
-   110, // POP3
-   143, // IMAP
-   161, // SNMP
-   443, // HTTPS
-   3389, // RDP
-   4949, // Munin
-   5800, // VNC
-   5900, // VNC
-   10050 // Zabbix
-}; /*!< List of well known ports. */
+static volatile sig_atomic_t stopped = 0; /*!< Flag of interrupted receiving. */
 
 params_t *parse_params(int argc, char **argv)
 {
    char *description, opt, usage[BUFFER_TMP], tmp[BUFFER_TMP];
+   long long first, last;
    params_t *params;
 
    description =
       "DDoS Detection\n"
       "Module for detecting and analyzing potential DDoS attacks in computer networks.\n"
       "\nSpecial parameters:\n"
+      "  -a PATH      Convert flow records into columnar archive and exit, no detection is run.\n"
+      "  -A ALGO      Set the k-means algorithm, lloyd (all distances), hamerly (bounded distances), minibatch (sampled hosts) or online (moves of single hosts), lloyd by default.\n"
+      "  -b PATH      Convert flow records into binary file and exit, no detection is run.\n"
+      "  -B NUM       Set the number of hosts sampled in one step of mini-batch k-means, 1024 by default.\n"
+      "  -c           Run detection over a snapshot of the interval while reading the next one.\n"
       "  -d NUM       Set the mode bit of DDoS detection, SYN flooding by default.\n"
       "  -e NUM       Set the number of iterations to flush the graph, 0 by default.\n"
-      "  -f PATH      Set the path of CSV file to be examined.\n"
+      "  -f PATH      Set the path of CSV, binary, archive, pcap or pcapng file, - for standard input.\n"
+      "  -j NUM       Set the number of threads parsing a regular file, 1 by default.\n"
       "  -k NUM       Set the number of clusters used by k-means algorithm, 2 by default.\n"
       "  -L LEVEL     Print graphs based on given verbosity level, range 1 to 5.\n"
+      "  -m LAYOUT    Set the layout of SYN packets matrix, row (by hosts) or col (by intervals), row by default.\n"
       "  -M LIMIT     Set the threshold for vertical port scan attack, 8192 by default.\n"
       "  -N LIMIT     Set the threshold for horizontal port scan attack, 4096 by default.\n"
+      "  -n           Decode NetFlow v5, v9 and IPFIX packets in capture file instead of aggregating packets.\n"
+      "  -o TIME      Set the reorder window of late flow records in seconds, 0 by default.\n"
       "  -p NUM       Show progress - print a dot every N flows.\n"
+      "  -P LIST      Index hosts of comma separated monitored prefixes in direct table, e.g. 10.0.0.0/16.\n"
+      "  -r FROM:TO   Process only flows starting in given range of Unix timestamps.\n"
+      "  -s SEEDING   Set seeding of k-means centroids, first or kmeans++, first by default.\n"
+      "  -S NUM       Set the number of shards aggregating hosts in worker threads, 0 by default.\n"
       "  -t TIME      Set the observation interval in seconds, 1 minute by default.\n"
+      "  -T MS        Set the time budget of mini-batch k-means in milliseconds including seeding and final assignment, half of the interval by default.\n"
+      "  -u PORT      Receive NetFlow v5, v9 and IPFIX packets on given UDP port instead of a file.\n"
       "  -w TIME      Set the observation time window in seconds, 1 hour by default.\n"
+      "  -W           Start k-means from centroids of the previous interval instead of fresh seeding.\n"
+      "  -x IDLE:ACT  Set idle and active timeouts of flows aggregated from packets, 15:60 by default.\n"
       "\nDetection modes:\n"
       "   1) SYN flooding detection only.\n"
       "   2) Vertical port scanning detection only.\n"
@@ -77,13 +78,65 @@ params_t *parse_params(int argc, char **argv)
    params->window_sum = 0;
    params->ver_threshold = VERTICAL_THRESHOLD;
    params->hor_threshold = HORIZONTAL_THRESHOLD;
+   params->threads = THREADS;
+   params->shards = SHARDS;
+   params->window = REORDER_WINDOW;
+   params->port = 0;
+   params->netflow = 0;
+   params->concurrent = 0;
+   params->idle = CACHE_IDLE;
+   params->active = CACHE_ACTIVE;
+   params->layout = LAYOUT_ROW;
+   params->algorithm = ALGORITHM_LLOYD;
+   params->warm = 0;
+   params->seeding = SEEDING_FIRST;
+   params->batch = BATCH_SIZE;
+   params->budget = BATCH_BUDGET;
+   params->prefixes_cnt = 0;
+   params->flows_cnt = 0;
    params->file = NULL;
    params->name = NULL;
+   params->output = NULL;
+   params->archive_file = NULL;
+   params->writer = NULL;
+   params->archive = NULL;
+   params->reorder = NULL;
+   params->range_first = 0;
+   params->range_last = UINT32_MAX;
 
    snprintf(usage, BUFFER_TMP, "Usage: %s -f FILE [OPTION]...\nTry `%s -h' for more information.\n", argv[0], argv[0]);
 
    while ((opt = getopt(argc, argv, OPTIONS)) != -1) {
       switch (opt) {
+         case 'a':
+            params->archive_file = optarg;
+            break;
+         case 'A':
+            if (strcmp(optarg, "lloyd") == 0) {
+               params->algorithm = ALGORITHM_LLOYD;
+            } else if (strcmp(optarg, "hamerly") == 0) {
+               params->algorithm = ALGORITHM_HAMERLY;
+            } else if (strcmp(optarg, "minibatch") == 0) {
+               params->algorithm = ALGORITHM_MINIBATCH;
+            } else if (strcmp(optarg, "online") == 0) {
+               params->algorithm = ALGORITHM_ONLINE;
+            } else {
+              fprintf(stderr, "%sInvalid k-means algorithm.\n", ERROR);
+              goto error;
+            }
+            break;
+         case 'b':
+            params->output = optarg;
+            break;
+         case 'B':
+            if (strlen(optarg) > NUMBER_LEN || sscanf(optarg, "%d%s", &params->batch, tmp) != 1 || params->batch <= 0) {
+              fprintf(stderr, "%sInvalid size of mini-batch.\n", ERROR);
+              goto error;
+            }
+            break;
+         case 'c':
+            params->concurrent = 1;
+            break;
          case 'd':
             if (strlen(optarg) > 1 || sscanf(optarg, "%d%s", &params->mode, tmp) != 1 || params->mode < 0 || params->mode > ALL_ATTACKS) {
               fprintf(stderr, "%sInvalid detection mode number.\n", ERROR);
@@ -105,17 +158,34 @@ params_t *parse_params(int argc, char **argv)
          case 'H':
             fprintf(stderr, "%s\n", description);
             return params;
+         case 'j':
+            if (strlen(optarg) > NUMBER_LEN || sscanf(optarg, "%d%s", &params->threads, tmp) != 1 || params->threads < 1 || params->threads > THREADS_MAX) {
+              fprintf(stderr, "%sInvalid number of parsing threads.\n", ERROR);
+              goto error;
+            }
+            break;
          case 'k':
-            if (strlen(optarg) > 1 || sscanf(optarg, "%d%s", &params->clusters, tmp) != 1 || params->clusters < CLUSTERS || params->clusters > CLUSTERS_MAX) {
+            if (strlen(optarg) > NUMBER_LEN || sscanf(optarg, "%d%s", &params->clusters, tmp) != 1 || params->clusters < CLUSTERS || params->clusters > CLUSTERS_MAX) {
               fprintf(stderr, "%sInvalid number of clusters to be used in k-means algorithm.\n", ERROR);
               goto error;
             }
+            break;
          case 'L':
             if (strlen(optarg) > 1 || sscanf(optarg, "%d%s", &params->level, tmp) != 1 || params->level < 0 || params->level > NUMBER_LEN) {
               fprintf(stderr, "%sInvalid verbosity level.\n", ERROR);
               goto error;
             }
             break;
+         case 'm':
+            if (strcmp(optarg, "row") == 0) {
+               params->layout = LAYOUT_ROW;
+            } else if (strcmp(optarg, "col") == 0) {
+               params->layout = LAYOUT_COLUMN;
+            } else {
+              fprintf(stderr, "%sInvalid layout of SYN packets matrix.\n", ERROR);
+              goto error;
+            }
+            break;
          case 'M':
             if (strlen(optarg) > NUMBER_LEN || sscanf(optarg, "%d%s", &params->ver_threshold, tmp) != 1 || params->interval <= 0) {
               fprintf(stderr, "%sInvalid vertical port scan threshold.\n", ERROR);
@@ -128,32 +198,92 @@ params_t *parse_params(int argc, char **argv)
               goto error;
             }
             break;
+         case 'n':
+            params->netflow = 1;
+            break;
+         case 'o':
+            if (strlen(optarg) > NUMBER_LEN || sscanf(optarg, "%d%s", &params->window, tmp) != 1 || params->window < 0) {
+              fprintf(stderr, "%sInvalid reorder window.\n", ERROR);
+              goto error;
+            }
+            break;
          case 'p':
             if (strlen(optarg) > NUMBER_LEN || sscanf(optarg, "%d%s", &params->progress, tmp) != 1 || params->progress < 0) {
               fprintf(stderr, "%sInvalid progress dot number.\n", ERROR);
               goto error;
             }
             break;
+         case 'P':
+            if (parse_prefixes(optarg, params->prefixes, &params->prefixes_cnt) != EXIT_SUCCESS) {
+              fprintf(stderr, "%sInvalid list of monitored prefixes.\n", ERROR);
+              goto error;
+            }
+            break;
+         case 'r':
+            if (strlen(optarg) > RANGE_LEN || sscanf(optarg, "%lld:%lld%s", &first, &last, tmp) != 2 || first < 0 || last < first) {
+              fprintf(stderr, "%sInvalid time range.\n", ERROR);
+              goto error;
+            }
+            params->range_first = first;
+            params->range_last = last;
+            break;
+         case 's':
+            if (strcmp(optarg, "first") == 0) {
+               params->seeding = SEEDING_FIRST;
+            } else if (strcmp(optarg, "kmeans++") == 0) {
+               params->seeding = SEEDING_KMEANSPP;
+            } else {
+              fprintf(stderr, "%sInvalid seeding of k-means centroids.\n", ERROR);
+              goto error;
+            }
+            break;
+         case 'S':
+            if (strlen(optarg) > NUMBER_LEN || sscanf(optarg, "%d%s", &params->shards, tmp) != 1 || params->shards < 0 || params->shards > THREADS_MAX) {
+              fprintf(stderr, "%sInvalid number of shards.\n", ERROR);
+              goto error;
+            }
+            break;
          case 't':
             if (strlen(optarg) > NUMBER_LEN || sscanf(optarg, "%d%s", &params->interval, tmp) != 1 || params->interval <= 0) {
               fprintf(stderr, "%sInvalid SYN packets observation interval.\n", ERROR);
               goto error;
             }
             break;
+         case 'T':
+            if (strlen(optarg) > NUMBER_LEN || sscanf(optarg, "%d%s", &params->budget, tmp) != 1 || params->budget <= 0) {
+              fprintf(stderr, "%sInvalid time budget of mini-batch k-means.\n", ERROR);
+              goto error;
+            }
+            break;
+         case 'u':
+            if (strlen(optarg) > NUMBER_LEN || sscanf(optarg, "%d%s", &params->port, tmp) != 1 || params->port <= 0 || params->port >= ALL_PORTS) {
+              fprintf(stderr, "%sInvalid UDP port number.\n", ERROR);
+              goto error;
+            }
+            break;
          case 'w':
             if (strlen(optarg) > NUMBER_LEN || sscanf(optarg, "%d%s", &params->time_window, tmp) != 1 || params->time_window <= 0) {
               fprintf(stderr, "%sInvalid observation time window.\n", ERROR);
               goto error;
             }
             break;
+         case 'W':
+            params->warm = 1;
+            break;
+         case 'x':
+            if (strlen(optarg) > RANGE_LEN || sscanf(optarg, "%d:%d%s", &params->idle, &params->active, tmp) != 2 || params->idle <= 0 || params->active <= 0) {
+              fprintf(stderr, "%sInvalid flow timeouts.\n", ERROR);
+              goto error;
+            }
+            break;
          default:
             fprintf(stderr, "%sToo many arguments.\n", ERROR);
             goto error;
       }
    }
 
-   if (params->file == NULL) {
-      fprintf(stderr, "%sYou must specify a data file.\n", ERROR);
+   if (params->file == NULL && params->port == 0) {
+      fprintf(stderr, "%sYou must specify a data file or UDP port.\n", ERROR);
       goto error;
    }
 
@@ -176,306 +306,1172 @@ params_t *parse_params(int argc, char **argv)
       return NULL;
 }
 
-char *parse_token(char **string, int *len)
+const char *parse_token(const char *line, int len, const uint32_t *delims, int cnt, int idx, int *size)
 {
-   int i;
-   char *tmp;
+   int first, last;
 
-   tmp = *string;
-   for (i = 0; i < *len; i ++) {
+   // Missing field.
+   if (idx > cnt) {
+      return NULL;
+   }
 
-      if (tmp[i] == DELIMITER) {
-         tmp[i] = 0;
-         *string += i + 1;
-         *len -= i + 1;
-         if (i == 0) {
-            return NULL;
-         } else {
-            return tmp;
+   if (idx == 0) {
+      first = 0;
+   } else {
+      first = delims[idx - 1] + 1;
+   }
+   if (idx < cnt) {
+      last = delims[idx];
+   } else {
+      last = len;
+   }
+
+   *size = last - first;
+   if (*size <= 0) {
+      return NULL;
+   } else {
+      return line + first;
+   }
+}
+
+int parse_ip4(const char *token, int size, in_addr_t *ip)
+{
+   int digits, i, parts;
+   uint32_t addr, octet;
+
+   addr = 0;
+   octet = 0;
+   digits = 0;
+   parts = 0;
+
+   for (i = 0; i < size; i ++) {
+      if (token[i] >= '0' && token[i] <= '9') {
+         // Leading zeros are not allowed.
+         if (digits == 1 && octet == 0) {
+            return EXIT_FAILURE;
+         }
+         octet = octet * 10 + (token[i] - '0');
+         if (octet > UINT8_MAX) {
+            return EXIT_FAILURE;
          }
+         digits ++;
+      } else if (token[i] == '.' && digits > 0 && parts < 3) {
+         addr = (addr << 8) | octet;
+         octet = 0;
+         digits = 0;
+         parts ++;
+      } else {
+         return EXIT_FAILURE;
       }
    }
-   *len -= i;
-   return tmp;
+   if (digits == 0 || parts != 3) {
+      return EXIT_FAILURE;
+   }
+
+   *ip = htonl((addr << 8) | octet);
+   return EXIT_SUCCESS;
+}
+
+int parse_uint(const char *token, int size, uint64_t max, uint64_t *value)
+{
+   int i;
+   uint64_t digit, x;
+
+   x = 0;
+   for (i = 0; i < size; i ++) {
+      digit = token[i] - '0';
+      if (digit > 9) {
+         return EXIT_FAILURE;
+      }
+      // Checking for overflow of the maximum value.
+      if (x > (max - digit) / 10) {
+         return EXIT_FAILURE;
+      }
+      x = x * 10 + digit;
+   }
+
+   *value = x;
+   return EXIT_SUCCESS;
 }
 
-int parse_line(graph_t *graph, flow_t *flow, char *line, int len)
+int parse_prefixes(const char *list, prefix_t *prefixes, int *prefixes_cnt)
 {
-   char *bytes, *dst_ip, *dst_port, *packets, *protocol, *src_ip, *src_port, *syn_flag, *time_first, *time_last;
+   int size;
+   const char *token, *slash, *end;
+   uint64_t len;
+   in_addr_t ip;
+
+   *prefixes_cnt = 0;
+   token = list;
+   while (*token != '\0') {
+      end = strchr(token, ',');
+      if (end == NULL) {
+         end = token + strlen(token);
+      }
+      slash = memchr(token, '/', end - token);
+      if (slash == NULL || *prefixes_cnt == PREFIXES_MAX) {
+         return EXIT_FAILURE;
+      }
+
+      // Converting address and length of the prefix, host bits are cleared.
+      size = slash - token;
+      if (parse_ip4(token, size, &ip) != EXIT_SUCCESS) {
+         return EXIT_FAILURE;
+      }
+      size = end - slash - 1;
+      if (parse_uint(slash + 1, size, 32, &len) != EXIT_SUCCESS || len < PREFIX_MIN) {
+         return EXIT_FAILURE;
+      }
+      prefixes[*prefixes_cnt].len = len;
+      prefixes[*prefixes_cnt].net = ntohl(ip);
+      if (len < 32) {
+         prefixes[*prefixes_cnt].net &= ~(UINT32_MAX >> len);
+      }
+      (*prefixes_cnt) ++;
+
+      token = (*end == ',') ? end + 1 : end;
+   }
+   return (*prefixes_cnt > 0) ? EXIT_SUCCESS : EXIT_FAILURE;
+}
+
+int parse_line(flow_t *flow, const char *line, int len, const uint32_t *delims, int cnt)
+{
+   int size;
+   uint64_t value;
+   const char *bytes, *dst_ip, *dst_port, *packets, *protocol, *src_ip, *src_port, *syn_flag, *time_first, *time_last;
 
    // Retrieving tokens.
-   dst_ip = parse_token(&line, &len);
+   dst_ip = parse_token(line, len, delims, cnt, FIELD_DST_IP, &size);
    if (dst_ip == NULL) {
       fprintf(stderr, "%sMissing destination IP address, parsing interrupted.\n", WARNING);
       return EXIT_FAILURE;
    }
-   if (inet_pton(AF_INET, dst_ip, &(flow->dst_ip)) != 1) {
+   if (parse_ip4(dst_ip, size, &(flow->dst_ip)) != EXIT_SUCCESS) {
          fprintf(stderr, "%sCannot convert string to destination IP address, parsing interrupted.\n", WARNING);
          return EXIT_FAILURE;
    }
 
-   src_ip = parse_token(&line, &len);
+   src_ip = parse_token(line, len, delims, cnt, FIELD_SRC_IP, &size);
    if (src_ip == NULL) {
       fprintf(stderr, "%sMissing source IP address, parsing interrupted.\n", WARNING);
       return EXIT_FAILURE;
    }
-   if (inet_pton(AF_INET, src_ip, &(flow->src_ip)) != 1) {
+   if (parse_ip4(src_ip, size, &(flow->src_ip)) != EXIT_SUCCESS) {
          fprintf(stderr, "%sCannot convert string to source IP address, parsing interrupted.\n", WARNING);
          return EXIT_FAILURE;
    }
 
-   dst_port = parse_token(&line, &len);
+   dst_port = parse_token(line, len, delims, cnt, FIELD_DST_PORT, &size);
    if (dst_port == NULL) {
       fprintf(stderr, "%sMissing destination port, parsing interrupted.\n", WARNING);
       return EXIT_FAILURE;
    }
-   flow->dst_port = atoi(dst_port);
-   if (flow->dst_port < 0 || flow->dst_port > ALL_PORTS) {
+   if (parse_uint(dst_port, size, ALL_PORTS - 1, &value) != EXIT_SUCCESS) {
       fprintf(stderr, "%sInvalid destination port number, parsing interrupted.\n", WARNING);
       return EXIT_FAILURE;
    }
+   flow->dst_port = value;
 
-   src_port = parse_token(&line, &len);
+   src_port = parse_token(line, len, delims, cnt, FIELD_SRC_PORT, &size);
    if (src_port == NULL) {
       fprintf(stderr, "%sMissing source port, parsing interrupted.\n", WARNING);
       return EXIT_FAILURE;
    }
-   flow->src_port = atoi(src_port);
-   if (flow->dst_port < 0 || flow->dst_port > ALL_PORTS) {
+   if (parse_uint(src_port, size, ALL_PORTS - 1, &value) != EXIT_SUCCESS) {
       fprintf(stderr, "%sInvalid source port number, parsing interrupted.\n", WARNING);
       return EXIT_FAILURE;
    }
+   flow->src_port = value;
 
-   protocol = parse_token(&line, &len);
+   protocol = parse_token(line, len, delims, cnt, FIELD_PROTOCOL, &size);
    if (protocol == NULL) {
       fprintf(stderr, "%sMissing used protocol, parsing interrupted.\n", WARNING);
       return EXIT_FAILURE;
    }
-   flow->protocol = atoi(protocol);
+   if (parse_uint(protocol, size, UINT8_MAX, &value) != EXIT_SUCCESS) {
+      fprintf(stderr, "%sInvalid protocol number, parsing interrupted.\n", WARNING);
+      return EXIT_FAILURE;
+   }
+   flow->protocol = value;
 
-   time_first = parse_token(&line, &len);
+   time_first = parse_token(line, len, delims, cnt, FIELD_TIME_FIRST, &size);
    if (time_first == NULL) {
       fprintf(stderr, "%sMissing time of the first packet, parsing interrupted.\n", WARNING);
       return EXIT_FAILURE;
    }
-   flow->time_first = atoi(time_first);
-
-   // Unknown field, skipping token.
-   parse_token(&line, &len);
+   if (parse_uint(time_first, size, UINT32_MAX, &value) != EXIT_SUCCESS) {
+      fprintf(stderr, "%sInvalid time of the first packet, parsing interrupted.\n", WARNING);
+      return EXIT_FAILURE;
+   }
+   flow->time_first = value;
 
-   time_last = parse_token(&line, &len);
+   time_last = parse_token(line, len, delims, cnt, FIELD_TIME_LAST, &size);
    if (time_last == NULL) {
       fprintf(stderr, "%sMissing time of the last packet, parsing interrupted.\n", WARNING);
       return EXIT_FAILURE;
    }
-   flow->time_last = atoi(time_last);
+   if (parse_uint(time_last, size, UINT32_MAX, &value) != EXIT_SUCCESS) {
+      fprintf(stderr, "%sInvalid time of the last packet, parsing interrupted.\n", WARNING);
+      return EXIT_FAILURE;
+   }
+   flow->time_last = value;
 
-   bytes = parse_token(&line, &len);
+   bytes = parse_token(line, len, delims, cnt, FIELD_BYTES, &size);
    if (bytes == NULL) {
       fprintf(stderr, "%sMissing number of transmitted bytes, parsing interrupted.\n", WARNING);
       return EXIT_FAILURE;
    }
-   flow->bytes = atoi(bytes);
+   if (parse_uint(bytes, size, UINT64_MAX, &value) != EXIT_SUCCESS) {
+      fprintf(stderr, "%sInvalid number of transmitted bytes, parsing interrupted.\n", WARNING);
+      return EXIT_FAILURE;
+   }
+   flow->bytes = value;
 
-   packets = parse_token(&line, &len);
+   packets = parse_token(line, len, delims, cnt, FIELD_PACKETS, &size);
    if (packets == NULL) {
       fprintf(stderr, "%sMissing number of transmitted packets, parsing interrupted.\n", WARNING);
       return EXIT_FAILURE;
    }
-   flow->packets = atoi(packets);
+   if (parse_uint(packets, size, UINT32_MAX, &value) != EXIT_SUCCESS) {
+      fprintf(stderr, "%sInvalid number of transmitted packets, parsing interrupted.\n", WARNING);
+      return EXIT_FAILURE;
+   }
+   flow->packets = value;
 
-   syn_flag = parse_token(&line, &len);
+   syn_flag = parse_token(line, len, delims, cnt, FIELD_SYN_FLAG, &size);
    if (syn_flag == NULL) {
       fprintf(stderr, "%sMissing SYN flag, parsing interrupted.\n", WARNING);
       return EXIT_FAILURE;
    }
-   flow->syn_flag = atoi(syn_flag);
+   if (parse_uint(syn_flag, size, UINT8_MAX, &value) != EXIT_SUCCESS) {
+      fprintf(stderr, "%sInvalid SYN flag, parsing interrupted.\n", WARNING);
+      return EXIT_FAILURE;
+   }
+   flow->syn_flag = value;
+
+   return EXIT_SUCCESS;
+}
+
+graph_t *parse_flow(graph_t *graph, flow_t *flow)
+{
+   flow_t tmp;
+   params_t *params;
+   reorder_t *reorder;
+
+   params = graph->params;
+
+   // Skipping flow record outside of the requested time range.
+   if (flow->time_first < params->range_first || flow->time_first > params->range_last) {
+      return graph;
+   }
+
+   // Converting flow record instead of the detection.
+   if (params->writer != NULL || params->archive != NULL) {
+      if ((params->writer != NULL && write_record(params->writer, flow) != EXIT_SUCCESS) ||
+          (params->archive != NULL && write_archive(params->archive, flow) != EXIT_SUCCESS)) {
+         free_graph(graph);
+         return NULL;
+      }
+      params->flows_cnt ++;
+      return graph;
+   }
+
+   if (params->reorder == NULL) {
+      return parse_interval(graph, flow);
+   }
+   reorder = params->reorder;
+
+   // Counting flow record arrived after a later one.
+   if (flow->time_first > reorder->time_max) {
+      reorder->time_max = flow->time_first;
+   } else if (flow->time_first < reorder->time_max) {
+      reorder->late_cnt ++;
+   }
+
+   // Passing flow record which cannot be sorted anymore.
+   if (flow->time_first < reorder->time_released) {
+      reorder->exceeded_cnt ++;
+      return parse_interval(graph, flow);
+   }
+
+   // Releasing the earliest record if the buffer is full.
+   if (reorder->entries_cnt == reorder->entries_max) {
+      pop_reorder(reorder, &tmp);
+      graph = parse_interval(graph, &tmp);
+      if (graph == NULL) {
+         return NULL;
+      }
+   }
+   push_reorder(reorder, flow);
+
+   return parse_reorder(graph, 0);
+}
+
+graph_t *parse_reorder(graph_t *graph, int flush)
+{
+   flow_t flow;
+   reorder_t *reorder;
+
+   reorder = graph->params->reorder;
+   while (ready_reorder(reorder, flush)) {
+      pop_reorder(reorder, &flow);
+      graph = parse_interval(graph, &flow);
+      if (graph == NULL) {
+         return NULL;
+      }
+   }
+   return graph;
+}
+
+graph_t *parse_interval(graph_t *graph, flow_t *flow)
+{
+   params_t *params;
+
+   params = graph->params;
 
    if (graph->window_first == 0) {
       graph->interval_first = flow->time_first;
-      graph->interval_last = flow->time_first + graph->params->interval;
+      graph->interval_last = flow->time_first + params->interval;
       graph->window_first = flow->time_first;
-      graph->window_last = flow->time_first + graph->params->time_window;
+      graph->window_last = flow->time_first + params->time_window;
    }
 
    // Delayed flow record, skipping line.
    if (flow->time_first < graph->interval_first) {
       fprintf(stderr, "%sDelayed flow record, parsing interrupted.\n", WARNING);
-      return EXIT_FAILURE;
+      return graph;
    }
+   params->flows_cnt ++;
 
-   return EXIT_SUCCESS;
+   // Interval reached, starting detection.
+   if (flow->time_first >= graph->interval_last) {
+      graph->interval_cnt ++;
+      if (params->progress > 0) {
+         fprintf(stderr, "\n");
+      }
+      // Shifting to the next interval.
+      graph->interval_idx = (graph->interval_idx + 1) % params->intvl_max;
+
+      // Starting detection over hosts of all shards.
+      if (graph->shards != NULL && merge_shards(graph) != EXIT_SUCCESS) {
+         free_graph(graph);
+         return NULL;
+      }
+      if (params->concurrent) {
+         if (parse_snapshot(graph) != EXIT_SUCCESS) {
+            free_graph(graph);
+            return NULL;
+         }
+      } else {
+         parse_detection(graph);
+      }
+
+      // Time window reached.
+      if (flow->time_first >= graph->window_last) {
+         params->window_sum ++;
+         graph->window_cnt ++;
+         // Cleaning graph.
+         if (params->flush_cnt == params->flush_iter) {
+            fprintf(stderr, "%sTime window reached, flushing whole graph.\n", INFO);
+            params->flush_cnt = 1;
+            free_graph(graph);
+            graph = create_graph(params);
+            if (graph == NULL) {
+               return NULL;
+            }
+            graph->interval_first = flow->time_first;
+            graph->interval_last = flow->time_first + params->interval;
+            graph->window_first = flow->time_first;
+            graph->window_last = flow->time_first + params->time_window;
+            goto get;
+         } else {
+            params->flush_cnt ++;
+            graph->window_last = graph->window_last + params->time_window;
+         }
+      }
+      // Shifting beginning of window, if not first window.
+      if (graph->window_cnt != 0) {
+         graph->window_first += params->interval;
+      }
+      reset_graph(graph);
+      graph->interval_first = graph->interval_last;
+      graph->interval_last = graph->interval_last + params->interval;
+   }
+
+   get:
+      // Adding host structure to graph or passing it to the shard of the host.
+      if (graph->shards != NULL) {
+         if (push_shard(graph, flow) != EXIT_SUCCESS) {
+            free_graph(graph);
+            return NULL;
+         }
+      } else {
+         graph = get_host(graph, flow);
+         if (graph == NULL) {
+            return NULL;
+         }
+      }
+      if (((params->mode & VER_PORTSCAN) == VER_PORTSCAN) || ((params->mode & HOR_PORTSCAN) == HOR_PORTSCAN)) {
+         count_port(graph, flow->dst_port);
+      }
+
+      if ((params->progress > 0) && (params->flows_cnt % params->progress == 0)) {
+         fprintf(stderr, ".");
+         fflush(stderr);
+      }
+
+   return graph;
 }
 
-graph_t *parse_data(params_t *params)
+graph_t *parse_lines(graph_t *graph, const char *data, size_t *len, int last)
 {
-   int i, j, k, len, pid, pipefd[2], ret, status;
-   char buffer[BUFFER_SIZE], *tmp;
-   uint32_t bytes;
-   uint64_t cnt_flows;
+   int cnt;
+   uint32_t delims[FIELDS];
+   const char *end, *line, *next;
    flow_t flow;
-   graph_t *graph;
 
-   j = k = 0;
-   cnt_flows = 0;
-   status = 0;
-   memset(buffer, 0, BUFFER_SIZE);
-   tmp = buffer;
-   graph = NULL;
+   line = data;
+   end = data + *len;
+   while (line < end) {
+      // Finding the end of line and delimiters in one pass.
+      next = scan_line(line, end, delims, &cnt);
+      if (next == end && last == 0) {
+         // Leaving interrupted line for the next block of data.
+         break;
+      }
 
-   graph = create_graph(params);
-   if (graph == NULL) {
-      goto error;
+      // Skipping empty and comment lines.
+      if (next != line && line[0] != '#') {
+         // Parsing for words.
+         if (parse_line(&flow, line, next - line, delims, cnt) == EXIT_SUCCESS) {
+            graph = parse_flow(graph, &flow);
+            if (graph == NULL) {
+               return NULL;
+            }
+         }
+      }
+      line = next + 1;
    }
 
-   // Creating pipe for standard output.
-   if (pipe(pipefd) != 0) {
-      fprintf(stderr, "%sCannot create a pipe.\n", ERROR);
-      goto error;
+   if (line > end) {
+      line = end;
    }
+   *len = line - data;
+   return graph;
+}
 
-   // Forking process to receive data.
-   if ((pid = fork()) == 0) {
-      close(pipefd[0]);
+void *parse_chunk(void *arg)
+{
+   int cnt;
+   uint32_t delims[FIELDS];
+   uint64_t idx;
+   const char *end, *line, *next;
+   flow_t *flows;
+   chunk_t *chunk;
+   pool_t *pool;
 
-      dup2(pipefd[1], 1);
+   pool = (pool_t *) arg;
 
-      close(pipefd[1]);
+   pthread_mutex_lock(&(pool->lock));
+   while (pool->stop == 0 && pool->offset < pool->size) {
+      // Waiting for the slot of the next chunk to be consumed by the graph.
+      idx = pool->next;
+      chunk = &(pool->chunks[idx % pool->chunks_cnt]);
+      if (chunk->state != CHUNK_FREE) {
+         pthread_cond_wait(&(pool->cond), &(pool->lock));
+         continue;
+      }
 
-      // Opening file with flows data.
-      if (graph->params->file != NULL) {
-         if ((execl("/bin/cat", "cat", graph->params->file, NULL)) < 0) {
-            fprintf(stderr, "%sCannot open given file.\n", ERROR);
-            goto error;
+      // Splitting the next chunk behind the end of line.
+      line = pool->data + pool->offset;
+      end = pool->data + pool->size;
+      if (end - line > CHUNK_SIZE) {
+         next = memchr(line + CHUNK_SIZE - 1, '\n', end - line - CHUNK_SIZE + 1);
+         if (next != NULL) {
+            end = next + 1;
          }
       }
+      pool->offset = end - pool->data;
+      pool->next ++;
+      chunk->state = CHUNK_BUSY;
+      chunk->idx = idx;
+      chunk->flows_cnt = 0;
+      pthread_mutex_unlock(&(pool->lock));
 
-      // Getting data from standard input.
-      else {
-         pipefd[0] = STDIN_FILENO;
+      // Parsing lines of the chunk into flow records.
+      while (line < end) {
+         next = scan_line(line, end, delims, &cnt);
+
+         // Skipping empty and comment lines.
+         if (next != line && line[0] != '#') {
+            // Reallocating array if needed.
+            if (chunk->flows_cnt == chunk->flows_max) {
+               flows = (flow_t *) realloc(chunk->flows, 2 * chunk->flows_max * sizeof(flow_t));
+               if (flows == NULL) {
+                  fprintf(stderr, "%sNot enough memory for parsed flow records.\n", ERROR);
+                  pthread_mutex_lock(&(pool->lock));
+                  pool->failed = 1;
+                  pool->stop = 1;
+                  pthread_cond_broadcast(&(pool->cond));
+                  break;
+               }
+               chunk->flows = flows;
+               chunk->flows_max *= 2;
+            }
+            if (parse_line(&(chunk->flows[chunk->flows_cnt]), line, next - line, delims, cnt) == EXIT_SUCCESS) {
+               chunk->flows_cnt ++;
+            }
+         }
+         line = next + 1;
       }
+      if (line < end) {
+         break;
+      }
+
+      pthread_mutex_lock(&(pool->lock));
+      chunk->state = CHUNK_READY;
+      pthread_cond_broadcast(&(pool->cond));
    }
+   pthread_mutex_unlock(&(pool->lock));
+   return NULL;
+}
 
-   // Error while forking the process
-   else if (pid < 0) {
-      fprintf(stderr, "%sCannot fork process.\n", ERROR);
-      goto error;
+graph_t *parse_chunks(graph_t *graph, const char *data, size_t size)
+{
+   int i, threads;
+   uint32_t j;
+   uint64_t idx;
+   chunk_t *chunk;
+   pthread_t workers[THREADS_MAX];
+   pool_t pool;
+
+   memset(&pool, 0, sizeof(pool_t));
+   pool.data = data;
+   pool.size = size;
+   pool.chunks_cnt = graph->params->threads * CHUNK_DEPTH;
+   pool.chunks = (chunk_t *) calloc(pool.chunks_cnt, sizeof(chunk_t));
+   if (pool.chunks == NULL) {
+      fprintf(stderr, "%sNot enough memory for parsed chunks.\n", ERROR);
+      free_graph(graph);
+      return NULL;
    }
+   for (i = 0; i < pool.chunks_cnt; i ++) {
+      pool.chunks[i].flows_max = FLOWS_INIT;
+      pool.chunks[i].flows = (flow_t *) calloc(FLOWS_INIT, sizeof(flow_t));
+      if (pool.chunks[i].flows == NULL) {
+         fprintf(stderr, "%sNot enough memory for parsed chunks.\n", ERROR);
+         pool.failed = 1;
+      }
+   }
+   pthread_mutex_init(&(pool.lock), NULL);
+   pthread_cond_init(&(pool.cond), NULL);
 
-   // Parent process
-   else {
-      close(pipefd[1]);
-
-      // Reading whole output.
-      while ((bytes = read(pipefd[0], tmp, BUFFER_SIZE - k)) != 0) {
-
-         // Parsing for lines
-         j = 0;
-         tmp = buffer;
-         for (i = 0; i < bytes + k; i ++) {
-
-            // Parsing line.
-            if (buffer[i] == '\n') {
-               len = i - j;
-               buffer[i] = 0;
-               // Skipping empty line
-               if (i == j) {
-                  goto next;
-               }
-               // Skipping comment line
-               if (buffer[j] == '#') {
-                  goto next;
-               }
+   // Starting parsing threads.
+   threads = 0;
+   if (pool.failed == 0) {
+      for (threads = 0; threads < graph->params->threads; threads ++) {
+         if (pthread_create(&(workers[threads]), NULL, parse_chunk, &pool) != 0) {
+            fprintf(stderr, "%sCannot create parsing thread.\n", ERROR);
+            pool.failed = 1;
+            break;
+         }
+      }
+   }
 
-               // Parsing for words.
-               ret = parse_line(graph, &flow, tmp, len);
-               if (ret == EXIT_SUCCESS) {
-                  cnt_flows ++;
-               } else {
-                  goto next;
-               }
+   // Passing parsed chunks to the graph in the order of the file.
+   for (idx = 0; pool.failed == 0; idx ++) {
+      chunk = &(pool.chunks[idx % pool.chunks_cnt]);
 
-               // Interval reached, starting detection.
-               if (flow.time_first >= graph->interval_last) {
-                  graph->interval_cnt ++;
-                  if (graph->params->progress > 0) {
-                     fprintf(stderr, "\n");
-                  }
-                  // Shifting to the next interval.
-                  graph->interval_idx = (graph->interval_idx + 1) % graph->params->intvl_max;
-
-                  // Starting detection.
-                  parse_detection(graph);
-
-                  // Time window reached.
-                  if (flow.time_first >= graph->window_last) {
-                     graph->params->window_sum ++;
-                     graph->window_cnt ++;
-                     // Cleaning graph.
-                     if (params->flush_cnt == params->flush_iter) {
-                        fprintf(stderr, "%sTime window reached, flushing whole graph.\n", INFO);
-                        params->flush_cnt = 1;
-                        free_graph(graph);
-                        graph = create_graph(params);
-                        if (graph == NULL) {
-                           goto error;
-                        }
-                        graph->interval_first = flow.time_first;
-                        graph->interval_last = flow.time_first + graph->params->interval;
-                        graph->window_first = flow.time_first;
-                        graph->window_last = flow.time_first + graph->params->time_window;
-                        goto get;
-                     } else {
-                        params->flush_cnt ++;
-                        graph->window_last = graph->window_last + params->time_window;
-                     }
-                  }
-                  // Shifting beginning of window, if not first window.
-                  if (graph->window_cnt != 0) {
-                     graph->window_first += params->interval;
-                  }
-                  reset_graph(graph);
-                  graph->interval_first = graph->interval_last;
-                  graph->interval_last = graph->interval_last + params->interval;
-               }
+      pthread_mutex_lock(&(pool.lock));
+      while (pool.failed == 0 && (chunk->state != CHUNK_READY || chunk->idx != idx) && (pool.offset < pool.size || idx < pool.next)) {
+         pthread_cond_wait(&(pool.cond), &(pool.lock));
+      }
+      pthread_mutex_unlock(&(pool.lock));
+
+      // All chunks have been processed.
+      if (pool.failed != 0 || chunk->state != CHUNK_READY || chunk->idx != idx) {
+         break;
+      }
+
+      for (j = 0; j < chunk->flows_cnt; j ++) {
+         graph = parse_flow(graph, &(chunk->flows[j]));
+         if (graph == NULL) {
+            break;
+         }
+      }
 
-               get:
-                  // Adding host structure to graph.
-                  graph = get_host(graph, &flow);
-                  if (graph == NULL) {
-                     goto error;
-                  }
-
-                  if ((params->progress > 0) && (cnt_flows % params->progress == 0)) {
-                   fprintf(stderr, ".");
-                   fflush(stderr);
-                  }
-
-               next:
-                  j += len + 1;
-                  tmp += len + 1;
+      pthread_mutex_lock(&(pool.lock));
+      chunk->state = CHUNK_FREE;
+      if (graph == NULL) {
+         pool.failed = 1;
+      }
+      pthread_cond_broadcast(&(pool.cond));
+      pthread_mutex_unlock(&(pool.lock));
+   }
+
+   // Stopping parsing threads.
+   pthread_mutex_lock(&(pool.lock));
+   pool.stop = 1;
+   pthread_cond_broadcast(&(pool.cond));
+   pthread_mutex_unlock(&(pool.lock));
+   for (i = 0; i < threads; i ++) {
+      pthread_join(workers[i], NULL);
+   }
+
+   if (pool.failed != 0 && graph != NULL) {
+      free_graph(graph);
+      graph = NULL;
+   }
+   for (i = 0; i < pool.chunks_cnt; i ++) {
+      free(pool.chunks[i].flows);
+   }
+   free(pool.chunks);
+   pthread_cond_destroy(&(pool.cond));
+   pthread_mutex_destroy(&(pool.lock));
+   return graph;
+}
+
+graph_t *parse_records(graph_t *graph, const char *data, size_t size)
+{
+   uint64_t cnt, i;
+   const record_header_t *header;
+   const record_t *records;
+   flow_t flow;
+
+   header = (const record_header_t *) data;
+   if (record_check(header, size) != EXIT_SUCCESS) {
+      free_graph(graph);
+      return NULL;
+   }
+
+   cnt = (size - header->header_size) / header->record_size;
+   records = (const record_t *) (data + header->header_size);
+   if (graph->params->level > VERBOSITY) {
+      fprintf(stderr, "%sReading %lu binary flow records.\n", INFO, cnt);
+   }
+
+   for (i = 0; i < cnt; i ++) {
+      record_unpack(&flow, &(records[i]));
+      graph = parse_flow(graph, &flow);
+      if (graph == NULL) {
+         return NULL;
+      }
+   }
+   return graph;
+}
+
+graph_t *parse_archive(graph_t *graph, const char *data, size_t size)
+{
+   int i;
+   uint32_t fields, j;
+   uint64_t cnt, k, offset;
+   const archive_header_t *header;
+   const archive_block_t *blocks;
+   flow_t *flows;
+   params_t *params;
+
+   params = graph->params;
+   if (archive_check(data, size) != EXIT_SUCCESS) {
+      free_graph(graph);
+      return NULL;
+   }
+   header = (const archive_header_t *) data;
+   blocks = (const archive_block_t *) (data + header->index_offset);
+
+   flows = (flow_t *) calloc(header->block_size, sizeof(flow_t));
+   if (flows == NULL) {
+      fprintf(stderr, "%sNot enough memory for archive block.\n", ERROR);
+      free_graph(graph);
+      return NULL;
+   }
+
+   // Decompressing only columns needed by the detection, all for the conversion.
+   if (params->writer != NULL || params->archive != NULL) {
+      fields = archive_fields(0);
+   } else {
+      fields = archive_fields(params->mode);
+   }
+
+   cnt = 0;
+   for (k = 0; k < header->blocks_cnt; k ++) {
+      // Skipping block outside of the requested time range.
+      if ((time_t) blocks[k].time_last < params->range_first || (time_t) blocks[k].time_first > params->range_last) {
+         continue;
+      }
+
+      memset(flows, 0, blocks[k].records_cnt * sizeof(flow_t));
+      offset = blocks[k].offset;
+      for (i = 0; i < ARCHIVE_COLUMNS; i ++) {
+         if ((fields & (1 << header->columns[i].field)) != 0) {
+            if (archive_decode(flows, blocks[k].records_cnt, (const uint8_t *) data + offset, blocks[k].sizes[i], &(header->columns[i])) != EXIT_SUCCESS) {
+               free(flows);
+               free_graph(graph);
+               return NULL;
             }
          }
+         offset += blocks[k].sizes[i];
+      }
 
-         // Shifting remaining bytes if the line was interrupted.
-         if (j != (bytes + k)) {
-            len = bytes + k - j;
-            memcpy(buffer, tmp, len);
-            tmp = buffer;
-            tmp += len;
-            k = len;
-         } else {
-            k = 0;
-            tmp = buffer;
+      for (j = 0; j < blocks[k].records_cnt; j ++) {
+         graph = parse_flow(graph, &(flows[j]));
+         if (graph == NULL) {
+            free(flows);
+            return NULL;
          }
       }
+      cnt ++;
+   }
+
+   if (params->level > VERBOSITY) {
+      fprintf(stderr, "%s%lu of %lu archive blocks have been read.\n", INFO, cnt, header->blocks_cnt);
+   }
+   free(flows);
+   return graph;
+}
+
+graph_t *parse_exports(graph_t *graph, capture_t *capture)
+{
+   int cnt, i;
+   packet_t packet;
+   netflow_t *netflow;
+
+   netflow = create_netflow(graph->params->time_window);
+   if (netflow == NULL) {
+      free_graph(graph);
+      return NULL;
+   }
+
+   while (read_packet(capture, &packet)) {
+      if (packet.protocol != PROTOCOL_UDP || packet.payload == NULL) {
+         continue;
+      }
+      cnt = decode_netflow(netflow, packet.payload, packet.payload_len, packet.src_ip);
+      for (i = 0; i < cnt; i ++) {
+         graph = parse_flow(graph, &(netflow->flows[i]));
+         if (graph == NULL) {
+            free_netflow(netflow);
+            return NULL;
+         }
+      }
+   }
+
+   if (graph->params->level > VERBOSITY) {
+      fprintf(stderr, "%s%lu packets read, %lu export packets decoded into %lu flow records.\n",
+              INFO, capture->packets_cnt, netflow->packets_cnt, netflow->flows_cnt);
+   }
+   if (netflow->missing_cnt > 0) {
+      fprintf(stderr, "%s%lu data sets skipped, their templates have not been received.\n", WARNING, netflow->missing_cnt);
+   }
+   if (netflow->dropped_cnt > 0) {
+      fprintf(stderr, "%s%lu flow records dropped over the limit of %d records per export packet.\n", WARNING, netflow->dropped_cnt, NETFLOW_FLOWS);
+   }
+   free_netflow(netflow);
+   return graph;
+}
+
+graph_t *parse_expired(graph_t *graph, cache_t *cache)
+{
+   uint32_t i;
+
+   for (i = 0; i < cache->expired_cnt; i ++) {
+      graph = parse_flow(graph, &(cache->expired[i]));
+      if (graph == NULL) {
+         return NULL;
+      }
+   }
+   cache->expired_cnt = 0;
+   return graph;
+}
+
+graph_t *parse_packets(graph_t *graph, capture_t *capture)
+{
+   time_t now;
+   packet_t packet;
+   cache_t *cache;
+   params_t *params;
+
+   params = graph->params;
+   cache = create_cache(CACHE_SIZE, params->idle, params->active);
+   if (cache == NULL) {
+      free_graph(graph);
+      return NULL;
+   }
+
+   // Sorting flows expired out of order unless converting.
+   if (params->writer == NULL && params->archive == NULL) {
+      if (params->reorder == NULL) {
+         params->reorder = create_reorder(params->idle + params->active, REORDER_SIZE);
+         if (params->reorder == NULL) {
+            goto error;
+         }
+      } else if (params->reorder->window < params->idle + params->active) {
+         params->reorder->window = params->idle + params->active;
+      }
+   }
+
+   now = 0;
+   while (read_packet(capture, &packet)) {
+      // Expiring idle flows once per second of the capture.
+      if (packet.time > now) {
+         now = packet.time;
+         while (expire_cache(cache, now, 0) > 0) {
+            if ((graph = parse_expired(graph, cache)) == NULL) {
+               goto error;
+            }
+         }
+      }
+
+      update_cache(cache, &packet);
+      if (cache->expired_cnt > 0 && (graph = parse_expired(graph, cache)) == NULL) {
+         goto error;
+      }
+   }
+
+   // Expiring all remaining flows at the end of the capture.
+   while (expire_cache(cache, now, 1) > 0) {
+      if ((graph = parse_expired(graph, cache)) == NULL) {
+         goto error;
+      }
+   }
+
+   if (params->level > VERBOSITY) {
+      fprintf(stderr, "%s%lu of %lu packets aggregated into %lu flows.\n",
+              INFO, cache->packets_cnt, capture->packets_cnt, cache->flows_cnt);
+   }
+   if (cache->evicted_cnt > 0) {
+      fprintf(stderr, "%s%lu flows expired early, the flow cache was full.\n", WARNING, cache->evicted_cnt);
+   }
+   free_cache(cache);
+   return graph;
+
+   // Cleaning up after error.
+   error:
+      free_cache(cache);
+      if (graph != NULL) {
+         free_graph(graph);
+      }
+      return NULL;
+}
+
+graph_t *parse_capture(graph_t *graph, const char *data, size_t size)
+{
+   capture_t *capture;
+
+   capture = create_capture(data, size);
+   if (capture == NULL) {
+      free_graph(graph);
+      return NULL;
+   }
+
+   if (graph->params->netflow) {
+      graph = parse_exports(graph, capture);
+   } else {
+      graph = parse_packets(graph, capture);
+   }
+   free_capture(capture);
+   return graph;
+}
+
+void parse_signal(int signum)
+{
+   (void) signum;
+   stopped = 1;
+}
+
+graph_t *parse_socket(graph_t *graph, int port)
+{
+   int cnt, fd, i, size;
+   uint8_t buffer[NETFLOW_BUFFER];
+   ssize_t bytes;
+   socklen_t addr_len;
+   struct sockaddr_in addr;
+   struct sigaction action;
+   netflow_t *netflow;
+
+   netflow = create_netflow(graph->params->time_window);
+   if (netflow == NULL) {
+      free_graph(graph);
+      return NULL;
+   }
+
+   fd = socket(AF_INET, SOCK_DGRAM, 0);
+   if (fd < 0) {
+      fprintf(stderr, "%sCannot create UDP socket.\n", ERROR);
+      goto error;
+   }
+   memset(&addr, 0, sizeof(struct sockaddr_in));
+   addr.sin_family = AF_INET;
+   addr.sin_addr.s_addr = htonl(INADDR_ANY);
+   addr.sin_port = htons(port);
+   if (bind(fd, (struct sockaddr *) &addr, sizeof(struct sockaddr_in)) != 0) {
+      fprintf(stderr, "%sCannot bind UDP port %d.\n", ERROR, port);
+      goto error;
+   }
+
+   // Enlarging receive buffer to absorb bursts of exporters during the detection.
+   size = NETFLOW_RCVBUF;
+   if (setsockopt(fd, SOL_SOCKET, SO_RCVBUF, &size, sizeof(int)) != 0) {
+      fprintf(stderr, "%sCannot enlarge receive buffer of UDP socket.\n", WARNING);
+   }
+
+   // Interrupting the receiving without restart, so the residues are processed.
+   memset(&action, 0, sizeof(struct sigaction));
+   action.sa_handler = parse_signal;
+   sigemptyset(&action.sa_mask);
+   sigaction(SIGINT, &action, NULL);
+   sigaction(SIGTERM, &action, NULL);
+   fprintf(stderr, "%sReceiving NetFlow and IPFIX packets on UDP port %d.\n", INFO, port);
+
+   while (!stopped) {
+      addr_len = sizeof(struct sockaddr_in);
+      bytes = recvfrom(fd, buffer, NETFLOW_BUFFER, 0, (struct sockaddr *) &addr, &addr_len);
+      if (bytes < 0) {
+         if (errno == EINTR) {
+            continue;
+         }
+         fprintf(stderr, "%sCannot receive data from UDP socket.\n", ERROR);
+         goto error;
+      }
+
+      // Templates are scoped by the exporter address.
+      cnt = decode_netflow(netflow, buffer, bytes, addr.sin_addr.s_addr);
+      for (i = 0; i < cnt; i ++) {
+         graph = parse_flow(graph, &(netflow->flows[i]));
+         if (graph == NULL) {
+            close(fd);
+            free_netflow(netflow);
+            return NULL;
+         }
+      }
+   }
+
+   signal(SIGINT, SIG_DFL);
+   signal(SIGTERM, SIG_DFL);
+   if (graph->params->level > VERBOSITY) {
+      fprintf(stderr, "%s%lu export packets decoded into %lu flow records, %lu packets or records malformed.\n",
+              INFO, netflow->packets_cnt, netflow->flows_cnt, netflow->invalid_cnt);
+   }
+   if (netflow->missing_cnt > 0) {
+      fprintf(stderr, "%s%lu data sets skipped, their templates have not been received.\n", WARNING, netflow->missing_cnt);
+   }
+   if (netflow->dropped_cnt > 0) {
+      fprintf(stderr, "%s%lu flow records dropped over the limit of %d records per export packet.\n", WARNING, netflow->dropped_cnt, NETFLOW_FLOWS);
+   }
+   close(fd);
+   free_netflow(netflow);
+   return graph;
+
+   // Cleaning up after error.
+   error:
+      if (fd >= 0) {
+         close(fd);
+      }
+      free_netflow(netflow);
+      free_graph(graph);
+      return NULL;
+}
+
+graph_t *parse_file(graph_t *graph, int fd, size_t size)
+{
+   char *data;
+   size_t len;
+
+   data = (char *) mmap(NULL, size, PROT_READ, MAP_PRIVATE, fd, 0);
+   if (data == MAP_FAILED) {
+      fprintf(stderr, "%sCannot map given file into memory, reading it as a stream.\n", WARNING);
+      return parse_stream(graph, fd);
+   }
+
+   // Reading columns and blocks of archive on demand, they might be skipped.
+   if (size >= sizeof(archive_header_t) && memcmp(data, ARCHIVE_MAGIC, ARCHIVE_MAGIC_LEN) == 0) {
+      graph = parse_archive(graph, data, size);
+      munmap(data, size);
+      return graph;
+   }
+
+   // Reading the whole file ahead and releasing parsed pages.
+   if (madvise(data, size, MADV_SEQUENTIAL) != 0) {
+      fprintf(stderr, "%sCannot advise sequential access to the mapped file.\n", WARNING);
+   }
+
+   // Reading packets from pcap or pcapng file.
+   if (capture_check(data, size) == EXIT_SUCCESS) {
+      graph = parse_capture(graph, data, size);
+   }
+
+   // Reading binary flow records without tokenizing.
+   else if (size >= sizeof(record_header_t) && memcmp(data, RECORD_MAGIC, RECORD_MAGIC_LEN) == 0) {
+      graph = parse_records(graph, data, size);
+   }
+
+   // Parsing large files by several threads.
+   else if (graph->params->threads > 1 && size > CHUNK_SIZE) {
+      graph = parse_chunks(graph, data, size);
+   } else {
+      len = size;
+      graph = parse_lines(graph, data, &len, 1);
+   }
+
+   munmap(data, size);
+   return graph;
+}
+
+graph_t *parse_stream(graph_t *graph, int fd)
+{
+   char buffer[BUFFER_SIZE];
+   size_t k, len;
+   ssize_t bytes;
 
-      // Waiting for child.
-      close(pipefd[0]);
-      if (wait(&status) < 0) {
-         fprintf(stderr, "%sChild process does not respond.\n", ERROR);
-         goto error;;
+   k = 0;
+   bytes = 0;
+
+   // Reading ahead the longest header to recognize binary input, it needs a regular file.
+   while (k < PCAP_HEADER_LEN && (bytes = read(fd, buffer + k, BUFFER_SIZE - k)) > 0) {
+      k += bytes;
+   }
+   if ((k >= ARCHIVE_MAGIC_LEN && memcmp(buffer, ARCHIVE_MAGIC, ARCHIVE_MAGIC_LEN) == 0) ||
+       (k >= RECORD_MAGIC_LEN && memcmp(buffer, RECORD_MAGIC, RECORD_MAGIC_LEN) == 0) ||
+       capture_check(buffer, k) == EXIT_SUCCESS) {
+      fprintf(stderr, "%sBinary input cannot be read from a stream, pass it as a regular file.\n", ERROR);
+      free_graph(graph);
+      return NULL;
+   }
+
+   // Reading whole output starting with the bytes read ahead.
+   if (bytes >= 0) {
+      bytes = k;
+      k = 0;
+   }
+   while (bytes > 0) {
+      len = k + bytes;
+      graph = parse_lines(graph, buffer, &len, 0);
+      if (graph == NULL) {
+         return NULL;
+      }
+
+      // Shifting remaining bytes if the line was interrupted.
+      k = k + bytes - len;
+      if (k == BUFFER_SIZE) {
+         fprintf(stderr, "%sToo long line in the input, parsing interrupted.\n", WARNING);
+         k = 0;
       }
+      memmove(buffer, buffer + len, k);
+      bytes = read(fd, buffer + k, BUFFER_SIZE - k);
+   }
+
+   if (bytes < 0) {
+      fprintf(stderr, "%sCannot read given input.\n", ERROR);
+      free_graph(graph);
+      return NULL;
+   }
+
+   // Parsing the last line without a newline.
+   if (k > 0) {
+      graph = parse_lines(graph, buffer, &k, 1);
+   }
+   return graph;
+}
+
+graph_t *parse_data(params_t *params)
+{
+   int fd;
+   struct stat st;
+   graph_t *graph;
+
+   fd = -1;
+   graph = NULL;
+
+   graph = create_graph(params);
+   if (graph == NULL) {
+      goto error;
+   }
+
+   // Creating binary or archive file for the conversion.
+   if (params->output != NULL) {
+      params->writer = create_writer(params->output);
+      if (params->writer == NULL) {
+         goto error;
+      }
+   }
+   if (params->archive_file != NULL) {
+      params->archive = create_archive(params->archive_file);
+      if (params->archive == NULL) {
+         goto error;
+      }
+   }
+
+   // Creating buffer for late flow records unless converting.
+   if (params->window > 0 && params->writer == NULL && params->archive == NULL) {
+      params->reorder = create_reorder(params->window, REORDER_SIZE);
+      if (params->reorder == NULL) {
+         goto error;
+      }
+   }
+
+   // Receiving flow records exported to UDP port.
+   if (params->port > 0) {
+      graph = parse_socket(graph, params->port);
+   }
+
+   // Reading flow records from file or standard input.
+   else {
+      // Getting data from standard input.
+      if (strcmp(params->file, STDIN_FILE) == 0) {
+         fd = STDIN_FILENO;
+      }
+
+      // Opening file with flows data.
+      else if ((fd = open(params->file, O_RDONLY)) < 0) {
+         fprintf(stderr, "%sCannot open given file.\n", ERROR);
+         goto error;
+      }
+
+      if (fstat(fd, &st) != 0) {
+         fprintf(stderr, "%sCannot get status of given file.\n", ERROR);
+         goto error;
+      }
+
+      // Mapping regular files, reading pipes and standard input through a buffer.
+      if (S_ISREG(st.st_mode) && st.st_size > 0) {
+         graph = parse_file(graph, fd, st.st_size);
+      } else {
+         graph = parse_stream(graph, fd);
+      }
+   }
+   if (graph == NULL) {
+      goto error;
+   }
+
+   if (fd > STDIN_FILENO) {
+      close(fd);
+   }
+
+   // Finishing the conversion, no detection is run.
+   if (params->writer != NULL || params->archive != NULL) {
+      if (params->writer != NULL && free_writer(params->writer) != EXIT_SUCCESS) {
+         params->writer = NULL;
+         goto error;
+      }
+      params->writer = NULL;
+      if (params->archive != NULL && free_archive(params->archive) != EXIT_SUCCESS) {
+         params->archive = NULL;
+         goto error;
+      }
+      params->archive = NULL;
+      fprintf(stderr, "%sAll %lu flow records have been converted.\n", INFO, params->flows_cnt);
+      return graph;
+   }
+
+   // Releasing all buffered flow records.
+   if (params->reorder != NULL) {
+      graph = parse_reorder(graph, 1);
+      if (graph == NULL) {
+         goto error;
+      }
+      fprintf(stderr, "%s%lu flow records arrived late, %lu of them exceeded the reorder window.\n",
+              INFO, params->reorder->late_cnt, params->reorder->exceeded_cnt);
+      free_reorder(params->reorder);
+      params->reorder = NULL;
    }
 
    if (graph->params->progress > 0) {
@@ -483,11 +1479,30 @@ graph_t *parse_data(params_t *params)
    }
    fprintf(stderr,"%sAll data have been successfully processed, processing residues.\n", INFO);
    graph->interval_idx = (graph->interval_idx + 1) % graph->params->intvl_max;
+   if (graph->shards != NULL && merge_shards(graph) != EXIT_SUCCESS) {
+      goto error;
+   }
+   wait_snapshot(graph);
    parse_detection(graph);
    return graph;
 
    // Cleaning up after error.
    error:
+      if (fd > STDIN_FILENO) {
+         close(fd);
+      }
+      if (params->writer != NULL) {
+         free_writer(params->writer);
+         params->writer = NULL;
+      }
+      if (params->archive != NULL) {
+         free_archive(params->archive);
+         params->archive = NULL;
+      }
+      if (params->reorder != NULL) {
+         free_reorder(params->reorder);
+         params->reorder = NULL;
+      }
       if (graph != NULL) {
          free_graph(graph);
       }
@@ -496,25 +1511,26 @@ graph_t *parse_data(params_t *params)
 
 void parse_detection(graph_t *graph)
 {
-   char flag;
-   int i, j;
-
    if (((graph->params->mode & SYN_FLOODING) == SYN_FLOODING) && (graph->interval_cnt > CONVERGENCE)) {
       if (graph->params->level > VERBOSITY) {
          fprintf(stderr, "%sStarting SYN flooding detection.\n", INFO);
       }
-      batch_cluster(graph);
+      if (graph->params->algorithm == ALGORITHM_HAMERLY) {
+         hamerly_cluster(graph);
+      } else if (graph->params->algorithm == ALGORITHM_MINIBATCH) {
+         minibatch_cluster(graph);
+      } else if (graph->params->algorithm == ALGORITHM_ONLINE) {
+         online_cluster(graph);
+      } else {
+         batch_cluster(graph);
+      }
    }
 
    if ((graph->params->mode & VER_PORTSCAN) == VER_PORTSCAN) {
       if (graph->params->level > VERBOSITY) {
          fprintf(stderr, "%sStarting vertical port scan detection.\n", INFO);
       }
-      for (i = 0; i < ALL_PORTS; i ++) {
-         if (graph->ports[i].accesses > 0) {
-            graph->ports_ver ++;
-         }
-      }
+      // Different ports are counted by count_port in parse_interval on their first access.
       if (graph->ports_ver > graph->params->ver_threshold) {
          graph->attack += VER_PORTSCAN;
          fprintf(stderr, "%sVertical port scan attack detected!\n", WARNING);
@@ -525,22 +1541,9 @@ void parse_detection(graph_t *graph)
       if (graph->params->level > VERBOSITY) {
          fprintf(stderr, "%sStarting horizontal port scan detection.\n", INFO);
       }
-      qsort(graph->ports, ALL_PORTS, sizeof(port_t), compare_port);
-      for (i = 0; i < ALL_PORTS; i ++) {
-         flag = 0;
-         for (j = 0; j < KNOWN_PORTS; j ++) {
-            if (graph->ports[i].port_num == known_ports[j]) {
-               flag = 1;
-               break;
-            }
-         }
-
-         // Non well-known port found among the highest accesses values.
-         if (flag == 0) {
-            graph->ports_hor = graph->ports[i].accesses;
-            break;
-         }
-      }
+      // The most accessed ports are tracked by count_port in parse_interval on each access.
+      fill_top(graph);
+      graph->ports_hor = graph->unknown_max;
       if (graph->ports_hor > graph->params->hor_threshold) {
          graph->attack += HOR_PORTSCAN;
          fprintf(stderr, "%sHorizontal port scan attack detected!\n", WARNING);
@@ -552,3 +1555,24 @@ void parse_detection(graph_t *graph)
       fprintf(stderr, "%sDetection for given interval finished, results available.\n", INFO);
    }
 }
+
+int parse_snapshot(graph_t *graph)
+{
+   // Freezing the interval once detection of the previous one has finished.
+   wait_snapshot(graph);
+   if (take_snapshot(graph) != EXIT_SUCCESS) {
+      return EXIT_FAILURE;
+   }
+   if (pthread_create(&(graph->detector), NULL, detect_snapshot, graph->snapshot) != 0) {
+      fprintf(stderr, "%sCannot create detection thread.\n", ERROR);
+      return EXIT_FAILURE;
+   }
+   graph->detecting = 1;
+   return EXIT_SUCCESS;
+}
+
+void *detect_snapshot(void *arg)
+{
+   parse_detection((graph_t *) arg);
+   return NULL;
+}
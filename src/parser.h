@@ -12,6 +12,55 @@
 #define _PARSER_
 
 #include "graph.h"
+#include "simd.h"
+#include "record.h"
+#include "archive.h"
+#include "reorder.h"
+#include "pcap.h"
+#include "netflow.h"
+#include "cache.h"
+#include "shard.h"
+
+/*!
+ * \brief Chunk state enumeration.
+ * State of a chunk slot shared by parsing threads and the graph.
+ */
+enum chunk_state {
+   CHUNK_FREE = 0, /*!< Slot is free to get a new chunk. */
+   CHUNK_BUSY = 1, /*!< Chunk is being parsed by a thread. */
+   CHUNK_READY = 2 /*!< Chunk is parsed and waiting for the graph. */
+};
+
+/*!
+ * \brief Chunk structure.
+ * Newline aligned part of a mapped file parsed by a thread into a batch
+ * of flow records.
+ */
+typedef struct chunk {
+   int state; /*!< State of the chunk slot. */
+   uint64_t idx; /*!< Sequence number of the chunk in the file. */
+   uint32_t flows_cnt; /*!< Number of parsed flow records. */
+   uint32_t flows_max; /*!< Maximum number of flow records in the array. */
+   flow_t *flows; /*!< Array of parsed flow records. */
+} chunk_t;
+
+/*!
+ * \brief Parsing pool structure.
+ * Structure shared by parsing threads to split a mapped file into chunks
+ * and hand the parsed chunks back in the order of the file.
+ */
+typedef struct pool {
+   pthread_mutex_t lock; /*!< Lock of the whole structure. */
+   pthread_cond_t cond; /*!< Condition signalled on every change of a chunk state. */
+   int stop; /*!< Flag to stop all threads. */
+   int failed; /*!< Flag of a failure in a thread. */
+   const char *data; /*!< Pointer to the mapped file. */
+   size_t size; /*!< Size of the file in bytes. */
+   size_t offset; /*!< Offset of the first byte not assigned to any chunk. */
+   uint64_t next; /*!< Sequence number of the next chunk to be assigned. */
+   int chunks_cnt; /*!< Number of chunk slots. */
+   chunk_t *chunks; /*!< Array of chunk slots. */
+} pool_t;
 
 /*!
  * \brief Parameters initialization.
@@ -25,31 +74,244 @@ params_t *parse_params(int argc, char **argv);
 
 /*!
  * \brief Parsing function.
- * Function to parse given line into tokens based on given delimeter.
- * \param[in,out] string Current pointer to token in line.
- * \param[in,out] len Current remaining characters in line.
+ * Function to retrieve a field of given line based on the positions
+ * of delimiters found by the line scanner. The line is not modified,
+ * so it can point directly into a read-only mapped file.
+ * \param[in] line Pointer to string with line to be parsed.
+ * \param[in] len Length of the line in bytes.
+ * \param[in] delims Array of offsets of delimiters within the line.
+ * \param[in] cnt Number of delimiters in the array.
+ * \param[in] idx Index of the field to be retrieved.
+ * \param[out] size Length of the token in bytes.
  * \return Pointer to the beginning of the token, NULL for empty value.
  */
-char *parse_token(char **string, int *len);
+const char *parse_token(const char *line, int len, const uint32_t *delims, int cnt, int idx, int *size);
+
+/*!
+ * \brief Converting function.
+ * Function to convert a dotted-quad token of known length into IPv4 address
+ * in network byte order without copying the token.
+ * \param[in] token Pointer to the beginning of the token.
+ * \param[in] size Length of the token in bytes.
+ * \param[out] ip Converted IPv4 address.
+ * \return EXIT_SUCCESS on success, otherwise EXIT_FAILURE.
+ */
+int parse_ip4(const char *token, int size, in_addr_t *ip);
+
+/*!
+ * \brief Converting function.
+ * Function to convert an unsigned decimal token of known length into a number
+ * with overflow and range checking.
+ * \param[in] token Pointer to the beginning of the token.
+ * \param[in] size Length of the token in bytes.
+ * \param[in] max Maximum allowed value of the number.
+ * \param[out] value Converted number.
+ * \return EXIT_SUCCESS on success, otherwise EXIT_FAILURE.
+ */
+int parse_uint(const char *token, int size, uint64_t max, uint64_t *value);
+
+/*!
+ * \brief Converting function.
+ * Function to convert comma separated list of prefixes in a.b.c.d/len notation
+ * into monitored prefixes, the length must be at least 8 bits.
+ * \param[in] list String with the list of prefixes.
+ * \param[out] prefixes Array of converted prefixes.
+ * \param[out] prefixes_cnt Number of converted prefixes.
+ * \return EXIT_SUCCESS on success, otherwise EXIT_FAILURE.
+ */
+int parse_prefixes(const char *list, prefix_t *prefixes, int *prefixes_cnt);
 
 /*!
  * \brief Parsing function.
  * Function to parse given line to tokens and convert them into values
  * of the flow record structure.
- * \param[in] graph Pointer to existing graph structure.
  * \param[in] flow Pointer to flow record structure.
  * \param[in] line Pointer to string with line to be parsed.
  * \param[in] len Length of the line in bytes.
+ * \param[in] delims Array of offsets of delimiters within the line.
+ * \param[in] cnt Number of delimiters in the array.
  * \return EXIT_SUCCESS on success, otherwise EXIT_FAILURE.
  */
-int parse_line(graph_t *graph, flow_t *flow, char *line, int len);
+int parse_line(flow_t *flow, const char *line, int len, const uint32_t *delims, int cnt);
+
+/*!
+ * \brief Flow handler.
+ * Function to add a parsed flow record to the graph. Records outside of
+ * the requested time range are skipped, records are converted into output
+ * files if requested or buffered in the reorder buffer until all late
+ * records within the window have arrived.
+ * \param[in] graph Pointer to existing graph structure.
+ * \param[in] flow Pointer to flow record structure.
+ * \return Pointer to graph structure on success, otherwise NULL.
+ */
+graph_t *parse_flow(graph_t *graph, flow_t *flow);
+
+/*!
+ * \brief Interval handler.
+ * Function to add a flow record in time order to the graph. It shifts the observation
+ * interval and launches the detection handler when the interval is reached,
+ * the graph might be flushed and created again when the time window is reached.
+ * \param[in] graph Pointer to existing graph structure.
+ * \param[in] flow Pointer to flow record structure.
+ * \return Pointer to graph structure on success, otherwise NULL.
+ */
+graph_t *parse_interval(graph_t *graph, flow_t *flow);
+
+/*!
+ * \brief Releasing function.
+ * Function to pass flow records from the reorder buffer to the interval
+ * handler, either those out of the window or all at the end of data.
+ * \param[in] graph Pointer to existing graph structure.
+ * \param[in] flush Flag to release all buffered flow records.
+ * \return Pointer to graph structure on success, otherwise NULL.
+ */
+graph_t *parse_reorder(graph_t *graph, int flush);
+
+/*!
+ * \brief Parsing lines function.
+ * Function to split given data into lines using the vectorized line scanner
+ * and pass every parsed flow record to the flow handler. The last interrupted line is left for the next call
+ * unless it is the last block of data.
+ * \param[in] graph Pointer to existing graph structure.
+ * \param[in] data Pointer to data to be parsed.
+ * \param[in,out] len Length of the data, number of processed bytes on return.
+ * \param[in] last Flag whether the data contains the end of input.
+ * \return Pointer to graph structure on success, otherwise NULL.
+ */
+graph_t *parse_lines(graph_t *graph, const char *data, size_t *len, int last);
+
+/*!
+ * \brief Parsing thread function.
+ * Function of a parsing thread to take the next newline aligned chunk
+ * of the mapped file and parse its lines into flow records.
+ * \param[in] arg Pointer to shared parsing pool structure.
+ * \return Always NULL.
+ */
+void *parse_chunk(void *arg);
+
+/*!
+ * \brief Parsing chunks function.
+ * Function to parse a mapped file by several threads. The parsed chunks are
+ * passed to the flow handler in the order of the file, so the graph is updated
+ * by a single thread exactly as by sequential parsing.
+ * \param[in] graph Pointer to existing graph structure.
+ * \param[in] data Pointer to the mapped file.
+ * \param[in] size Size of the file in bytes.
+ * \return Pointer to graph structure on success, otherwise NULL.
+ */
+graph_t *parse_chunks(graph_t *graph, const char *data, size_t size);
+
+/*!
+ * \brief Parsing records function.
+ * Function to pass binary flow records to the flow handler without any
+ * tokenizing or conversion of text.
+ * \param[in] graph Pointer to existing graph structure.
+ * \param[in] data Pointer to the mapped binary file.
+ * \param[in] size Size of the file in bytes.
+ * \return Pointer to graph structure on success, otherwise NULL.
+ */
+graph_t *parse_records(graph_t *graph, const char *data, size_t size);
+
+/*!
+ * \brief Parsing archive function.
+ * Function to pass flow records from columnar archive to the flow handler.
+ * Only the columns needed by the detection mode are decompressed and blocks
+ * outside of the requested time range are skipped.
+ * \param[in] graph Pointer to existing graph structure.
+ * \param[in] data Pointer to the mapped archive file.
+ * \param[in] size Size of the file in bytes.
+ * \return Pointer to graph structure on success, otherwise NULL.
+ */
+graph_t *parse_archive(graph_t *graph, const char *data, size_t size);
+
+/*!
+ * \brief Parsing exports function.
+ * Function to decode NetFlow v5, v9 and IPFIX packets carried by UDP in a packet
+ * capture and pass exported flow records to the flow handler.
+ * \param[in] graph Pointer to existing graph structure.
+ * \param[in] capture Pointer to existing capture reader.
+ * \return Pointer to graph structure on success, otherwise NULL.
+ */
+graph_t *parse_exports(graph_t *graph, capture_t *capture);
+
+/*!
+ * \brief Parsing expired function.
+ * Function to pass flows expired from the flow cache to the flow handler.
+ * \param[in] graph Pointer to existing graph structure.
+ * \param[in] cache Pointer to existing flow cache.
+ * \return Pointer to graph structure on success, otherwise NULL.
+ */
+graph_t *parse_expired(graph_t *graph, cache_t *cache);
+
+/*!
+ * \brief Parsing packets function.
+ * Function to aggregate captured packets into flows keyed by 5-tuple with idle
+ * and active timeouts. Flows expire out of order, so they are sorted in the
+ * reorder buffer with the window of at least both timeouts.
+ * \param[in] graph Pointer to existing graph structure.
+ * \param[in] capture Pointer to existing capture reader.
+ * \return Pointer to graph structure on success, otherwise NULL.
+ */
+graph_t *parse_packets(graph_t *graph, capture_t *capture);
+
+/*!
+ * \brief Parsing capture function.
+ * Function to read pcap or pcapng file, packets are aggregated into flows or
+ * NetFlow and IPFIX packets are decoded if requested.
+ * \param[in] graph Pointer to existing graph structure.
+ * \param[in] data Pointer to the mapped capture file.
+ * \param[in] size Size of the file in bytes.
+ * \return Pointer to graph structure on success, otherwise NULL.
+ */
+graph_t *parse_capture(graph_t *graph, const char *data, size_t size);
+
+/*!
+ * \brief Signal handler.
+ * Function to stop receiving export packets, so the residues can be processed.
+ * \param[in] signum Number of received signal.
+ */
+void parse_signal(int signum);
+
+/*!
+ * \brief Parsing socket function.
+ * Function to receive NetFlow v5, v9 and IPFIX packets on a local UDP port
+ * and pass exported flow records to the flow handler until interrupted.
+ * \param[in] graph Pointer to existing graph structure.
+ * \param[in] port Number of UDP port to listen on.
+ * \return Pointer to graph structure on success, otherwise NULL.
+ */
+graph_t *parse_socket(graph_t *graph, int port);
+
+/*!
+ * \brief Parsing file function.
+ * Function to map a regular file into memory and parse it directly without
+ * copying the data through a pipe. Binary flow records, archive and capture
+ * files are recognized by the magic number in the header.
+ * \param[in] graph Pointer to existing graph structure.
+ * \param[in] fd File descriptor of the opened file.
+ * \param[in] size Size of the file in bytes.
+ * \return Pointer to graph structure on success, otherwise NULL.
+ */
+graph_t *parse_file(graph_t *graph, int fd, size_t size);
+
+/*!
+ * \brief Parsing stream function.
+ * Function to read data from a pipe or standard input into a buffer
+ * and parse all complete lines. Binary flow records, archive and capture
+ * files are recognized by the magic number and rejected, they need a regular file.
+ * \param[in] graph Pointer to existing graph structure.
+ * \param[in] fd File descriptor of the stream.
+ * \return Pointer to graph structure on success, otherwise NULL.
+ */
+graph_t *parse_stream(graph_t *graph, int fd);
 
 /*!
  * \brief Parsing data function
- * Function to parse data using forking process through pipe. It opens a pipe
- * to redirect standard output which receives all desired data. It creates a new graph
+ * Function to parse data from given file, standard input or UDP port. Regular files are
+ * mapped into memory, other inputs are read through a buffer. It creates a new graph
  * structure which is filled with the parsed data. After a time window is reached,
- * the detection handler is launched.
+ * the detection handler is launched. If an output file is set, all flow records
+ * are converted into binary or archive file instead of the detection.
  * \param[in] params Pointer to structure with all initialized parameters.
  * \return Pointer to graph structure on success, otherwise NULL.
  */
@@ -63,4 +325,22 @@ graph_t *parse_data(params_t *params);
  */
 void parse_detection(graph_t *graph);
 
+/*!
+ * \brief Snapshot detection handler
+ * Function to freeze the aggregated interval into the snapshot of the graph
+ * and hand it to a detection thread, so reading of the next interval continues
+ * immediately. Detection of the previous snapshot is awaited first.
+ * \param[in] graph Pointer to existing graph structure.
+ * \return EXIT_SUCCESS on success, otherwise EXIT_FAILURE.
+ */
+int parse_snapshot(graph_t *graph);
+
+/*!
+ * \brief Detection thread function.
+ * Function run by detection thread to run detection handler over the snapshot.
+ * \param[in] arg Pointer to the snapshot graph structure.
+ * \return Always NULL.
+ */
+void *detect_snapshot(void *arg);
+
 #endif /* _PARSER_ */
@@ -0,0 +1,330 @@
+/*!
+ * \file pcap.c
+ * \brief Packet capture library.
+ * \author Jan Neuzil <neuzija1@fit.cvut.cz>
+ * \date 2014
+ */
+/*
+ * Copyright (C) 2014 ISEP
+ */
+
+#include "pcap.h"
+
+/*!
+ * \brief Swapping macros.
+ * Conversion of numbers written in byte order of the capture file.
+ */
+#define swap16(c, x) ((c)->swapped ? __builtin_bswap16(x) : (x))
+#define swap32(c, x) ((c)->swapped ? __builtin_bswap32(x) : (x))
+
+int capture_check(const char *data, size_t size)
+{
+   uint32_t magic;
+
+   if (size < PCAP_HEADER_LEN) {
+      return EXIT_FAILURE;
+   }
+   memcpy(&magic, data, sizeof(uint32_t));
+   if (magic == PCAP_MAGIC || magic == PCAP_MAGIC_NSEC || magic == PCAPNG_SECTION ||
+       magic == __builtin_bswap32(PCAP_MAGIC) || magic == __builtin_bswap32(PCAP_MAGIC_NSEC)) {
+      return EXIT_SUCCESS;
+   }
+   return EXIT_FAILURE;
+}
+
+capture_t *create_capture(const char *data, size_t size)
+{
+   uint32_t header[PCAP_HEADER_LEN / sizeof(uint32_t)];
+   capture_t *capture;
+
+   if (capture_check(data, size) != EXIT_SUCCESS) {
+      fprintf(stderr, "%sGiven file is not a packet capture file.\n", ERROR);
+      return NULL;
+   }
+
+   capture = (capture_t *) calloc(1, sizeof(capture_t));
+   if (capture == NULL) {
+      fprintf(stderr, "%sNot enough memory for capture reader.\n", ERROR);
+      return NULL;
+   }
+   capture->data = (const uint8_t *) data;
+   capture->size = size;
+   capture->offset = 0;
+   capture->released = 0;
+
+   // Reading sections and interfaces of pcapng file together with packets.
+   memcpy(header, data, PCAP_HEADER_LEN);
+   if (header[0] == PCAPNG_SECTION) {
+      capture->ng = 1;
+      return capture;
+   }
+
+   capture->offset = PCAP_HEADER_LEN;
+   capture->swapped = (header[0] != PCAP_MAGIC && header[0] != PCAP_MAGIC_NSEC);
+   capture->ifaces_cnt = 1;
+   capture->links[0] = swap32(capture, header[5]);
+   capture->units[0] = (swap32(capture, header[0]) == PCAP_MAGIC_NSEC) ? 1000000000 : 1000000;
+
+   if (capture->links[0] != LINK_ETHERNET && capture->links[0] != LINK_RAW && capture->links[0] != LINK_SLL) {
+      fprintf(stderr, "%sUnsupported link layer type %u of capture file.\n", ERROR, capture->links[0]);
+      free(capture);
+      return NULL;
+   }
+   return capture;
+}
+
+void free_capture(capture_t *capture)
+{
+   free(capture);
+}
+
+int decode_packet(packet_t *packet, const uint8_t *frame, uint32_t len, uint32_t link)
+{
+   uint16_t type;
+   uint32_t hlen, offset, total;
+   const uint8_t *ip, *l4;
+
+   // Skipping link layer header and VLAN tags.
+   switch (link) {
+      case LINK_ETHERNET:
+         if (len < ETHER_LEN) {
+            return EXIT_FAILURE;
+         }
+         type = be16(frame + 12);
+         offset = ETHER_LEN;
+         while ((type == ETHERTYPE_VLAN || type == ETHERTYPE_QINQ) && len >= offset + VLAN_LEN) {
+            type = be16(frame + offset + 2);
+            offset += VLAN_LEN;
+         }
+         break;
+      case LINK_SLL:
+         if (len < SLL_LEN) {
+            return EXIT_FAILURE;
+         }
+         type = be16(frame + 14);
+         offset = SLL_LEN;
+         break;
+      case LINK_RAW:
+         type = ETHERTYPE_IP4;
+         offset = 0;
+         break;
+      default:
+         return EXIT_FAILURE;
+   }
+
+   // Checking IPv4 header.
+   ip = frame + offset;
+   len -= offset;
+   if (type != ETHERTYPE_IP4 || len < IP4_LEN || (ip[0] >> 4) != 4) {
+      return EXIT_FAILURE;
+   }
+   hlen = (ip[0] & 0x0f) * 4;
+   total = be16(ip + 2);
+   if (hlen < IP4_LEN || hlen > len || total < hlen) {
+      return EXIT_FAILURE;
+   }
+   if (total < len) {
+      len = total;
+   }
+
+   memcpy(&(packet->src_ip), ip + 12, sizeof(in_addr_t));
+   memcpy(&(packet->dst_ip), ip + 16, sizeof(in_addr_t));
+   packet->protocol = ip[9];
+   packet->length = total;
+   packet->src_port = 0;
+   packet->dst_port = 0;
+   packet->tcp_flags = 0;
+   packet->payload = NULL;
+   packet->payload_len = 0;
+
+   // Fragments behind the first one have no transport header.
+   if ((be16(ip + 6) & 0x1fff) != 0) {
+      return EXIT_SUCCESS;
+   }
+
+   l4 = ip + hlen;
+   len -= hlen;
+   if (packet->protocol == PROTOCOL_UDP && len >= UDP_LEN) {
+      packet->src_port = be16(l4);
+      packet->dst_port = be16(l4 + 2);
+      packet->payload = l4 + UDP_LEN;
+      packet->payload_len = len - UDP_LEN;
+   } else if (packet->protocol == PROTOCOL_TCP && len >= TCP_LEN) {
+      packet->src_port = be16(l4);
+      packet->dst_port = be16(l4 + 2);
+      packet->tcp_flags = l4[13];
+      hlen = (l4[12] >> 4) * 4;
+      if (hlen >= TCP_LEN && hlen <= len) {
+         packet->payload = l4 + hlen;
+         packet->payload_len = len - hlen;
+      }
+   }
+   return EXIT_SUCCESS;
+}
+
+int read_block(capture_t *capture, const uint8_t **frame, uint32_t *len, uint32_t *iface, uint64_t *ts)
+{
+   uint8_t resolution;
+   uint16_t code, opt_len, link;
+   uint32_t block_len, body_len, i, offset, type, words[5];
+   uint64_t units;
+   const uint8_t *block, *body;
+
+   while (capture->offset + PCAPNG_BLOCK_LEN <= capture->size) {
+      block = capture->data + capture->offset;
+      memcpy(words, block, 3 * sizeof(uint32_t));
+
+      // Starting a new section with its own byte order and interfaces.
+      if (words[0] == PCAPNG_SECTION) {
+         capture->swapped = (words[2] != PCAPNG_ORDER);
+         capture->ifaces_cnt = 0;
+      }
+      type = swap32(capture, words[0]);
+      block_len = swap32(capture, words[1]);
+      if (block_len < PCAPNG_BLOCK_LEN || block_len % sizeof(uint32_t) != 0 || block_len > capture->size - capture->offset) {
+         fprintf(stderr, "%sCapture file is truncated or corrupted, the rest skipped.\n", WARNING);
+         capture->offset = capture->size;
+         break;
+      }
+      capture->offset += block_len;
+      body = block + 2 * sizeof(uint32_t);
+      body_len = block_len - PCAPNG_BLOCK_LEN;
+
+      switch (type) {
+         case PCAPNG_INTERFACE:
+            if (body_len < 2 * sizeof(uint32_t)) {
+               break;
+            }
+            memcpy(&link, body, sizeof(uint16_t));
+            units = 1000000;
+
+            // Looking for timestamp resolution among options.
+            offset = 2 * sizeof(uint32_t);
+            while (offset + sizeof(uint32_t) <= body_len) {
+               memcpy(&code, body + offset, sizeof(uint16_t));
+               memcpy(&opt_len, body + offset + 2, sizeof(uint16_t));
+               code = swap16(capture, code);
+               opt_len = swap16(capture, opt_len);
+               offset += sizeof(uint32_t);
+               if (code == 0) {
+                  break;
+               }
+               if (code == PCAPNG_TSRESOL && opt_len >= 1 && offset < body_len) {
+                  resolution = body[offset];
+                  if ((resolution & 0x80) != 0) {
+                     units = (uint64_t) 1 << ((resolution & 0x7f) > 63 ? 63 : (resolution & 0x7f));
+                  } else {
+                     units = 1;
+                     for (i = 0; i < resolution && i < 19; i ++) {
+                        units *= 10;
+                     }
+                  }
+               }
+               offset += (opt_len + 3) & ~3;
+            }
+            if (capture->ifaces_cnt < CAPTURE_IFACES) {
+               capture->links[capture->ifaces_cnt] = swap16(capture, link);
+               capture->units[capture->ifaces_cnt] = units;
+            }
+            capture->ifaces_cnt ++;
+            break;
+         case PCAPNG_ENHANCED:
+         case PCAPNG_PACKET:
+            if (body_len < 5 * sizeof(uint32_t)) {
+               break;
+            }
+            memcpy(words, body, 5 * sizeof(uint32_t));
+            for (i = 0; i < 5; i ++) {
+               words[i] = swap32(capture, words[i]);
+            }
+            if (words[3] > body_len - 5 * sizeof(uint32_t)) {
+               break;
+            }
+
+            // Obsolete packet block has 16 bit interface identifier.
+            if (type == PCAPNG_PACKET) {
+               memcpy(&code, body, sizeof(uint16_t));
+               words[0] = swap16(capture, code);
+            }
+            *frame = body + 5 * sizeof(uint32_t);
+            *len = words[3];
+            *iface = words[0];
+            *ts = ((uint64_t) words[1] << 32) | words[2];
+            return 1;
+         case PCAPNG_SIMPLE:
+            if (body_len < sizeof(uint32_t)) {
+               break;
+            }
+            memcpy(words, body, sizeof(uint32_t));
+            *frame = body + sizeof(uint32_t);
+            *len = swap32(capture, words[0]);
+            if (*len > body_len - sizeof(uint32_t)) {
+               *len = body_len - sizeof(uint32_t);
+            }
+            *iface = 0;
+            *ts = UINT64_MAX;
+            return 1;
+         default:
+            break;
+      }
+   }
+   return 0;
+}
+
+int read_packet(capture_t *capture, packet_t *packet)
+{
+   uint32_t iface, len, header[PCAP_RECORD_LEN / sizeof(uint32_t)];
+   uint64_t ts, units;
+   size_t end;
+   const uint8_t *frame;
+
+   while (1) {
+      // Releasing pages of the mapped file which have been read.
+      if (capture->offset >= capture->released + CAPTURE_RELEASE) {
+         end = capture->offset - capture->offset % CAPTURE_RELEASE;
+         madvise((void *) (capture->data + capture->released), end - capture->released, MADV_DONTNEED);
+         capture->released = end;
+      }
+
+      if (capture->ng) {
+         if (!read_block(capture, &frame, &len, &iface, &ts)) {
+            return 0;
+         }
+      } else {
+         if (capture->offset + PCAP_RECORD_LEN > capture->size) {
+            return 0;
+         }
+         frame = capture->data + capture->offset;
+         memcpy(header, frame, PCAP_RECORD_LEN);
+         len = swap32(capture, header[2]);
+         if (len > capture->size - capture->offset - PCAP_RECORD_LEN) {
+            fprintf(stderr, "%sCapture file is truncated, the last packet skipped.\n", WARNING);
+            capture->offset = capture->size;
+            return 0;
+         }
+         capture->offset += PCAP_RECORD_LEN + len;
+         frame += PCAP_RECORD_LEN;
+         iface = 0;
+         ts = (uint64_t) swap32(capture, header[0]) * capture->units[0] + swap32(capture, header[1]);
+      }
+      capture->packets_cnt ++;
+
+      if (iface >= capture->ifaces_cnt || iface >= CAPTURE_IFACES ||
+          decode_packet(packet, frame, len, capture->links[iface]) != EXIT_SUCCESS) {
+         capture->skipped_cnt ++;
+         continue;
+      }
+
+      // Simple packet block has no timestamp, the last one is used.
+      units = capture->units[iface];
+      if (ts == UINT64_MAX) {
+         packet->time = capture->time;
+         packet->usec = 0;
+      } else {
+         packet->time = ts / units;
+         packet->usec = (units >= 1000000) ? (ts % units) / (units / 1000000) : (ts % units) * 1000000 / units;
+      }
+      capture->time = packet->time;
+      return 1;
+   }
+}
@@ -0,0 +1,151 @@
+/*!
+ * \file pcap.h
+ * \brief Header file to packet capture library.
+ * \author Jan Neuzil <neuzija1@fit.cvut.cz>
+ * \date 2014
+ */
+/*
+ * Copyright (C) 2014 ISEP
+ */
+
+#ifndef _PCAP_
+#define _PCAP_
+
+#include "main.h"
+
+/*!
+ * \name Capture format values.
+ * Defines macros used by packet capture files and network headers.
+ * \{ */
+#define PCAP_MAGIC 0xa1b2c3d4 /*!< Magic number of capture file with microseconds. */
+#define PCAP_MAGIC_NSEC 0xa1b23c4d /*!< Magic number of capture file with nanoseconds. */
+#define PCAP_HEADER_LEN 24 /*!< Size of the global header of capture file. */
+#define PCAP_RECORD_LEN 16 /*!< Size of the header of captured packet. */
+#define PCAPNG_SECTION 0x0a0d0d0a /*!< Block type of pcapng section header. */
+#define PCAPNG_INTERFACE 1 /*!< Block type of pcapng interface description. */
+#define PCAPNG_PACKET 2 /*!< Block type of obsolete pcapng packet. */
+#define PCAPNG_SIMPLE 3 /*!< Block type of pcapng simple packet. */
+#define PCAPNG_ENHANCED 6 /*!< Block type of pcapng enhanced packet. */
+#define PCAPNG_ORDER 0x1a2b3c4d /*!< Byte order magic of pcapng section. */
+#define PCAPNG_BLOCK_LEN 12 /*!< Size of the header and trailer of pcapng block. */
+#define PCAPNG_TSRESOL 9 /*!< Option code of timestamp resolution of interface. */
+#define CAPTURE_IFACES 64 /*!< Maximum number of interfaces in pcapng section. */
+#define CAPTURE_RELEASE 67108864 /*!< Size of read data released from memory at once. */
+
+#define LINK_ETHERNET 1 /*!< Ethernet link layer type. */
+#define LINK_RAW 101 /*!< Raw IP link layer type. */
+#define LINK_SLL 113 /*!< Linux cooked capture link layer type. */
+
+#define ETHER_LEN 14 /*!< Size of Ethernet header. */
+#define SLL_LEN 16 /*!< Size of Linux cooked capture header. */
+#define VLAN_LEN 4 /*!< Size of VLAN tag. */
+#define ETHERTYPE_IP4 0x0800 /*!< Ethernet type of IPv4. */
+#define ETHERTYPE_VLAN 0x8100 /*!< Ethernet type of VLAN tag. */
+#define ETHERTYPE_QINQ 0x88a8 /*!< Ethernet type of stacked VLAN tag. */
+#define IP4_LEN 20 /*!< Minimum size of IPv4 header. */
+#define UDP_LEN 8 /*!< Size of UDP header. */
+#define TCP_LEN 20 /*!< Minimum size of TCP header. */
+/*! \} */
+
+/*!
+ * \brief Capture structure.
+ * Structure of a mapped pcap or pcapng file being read packet by packet.
+ * Classic pcap file is handled as a single interface.
+ */
+typedef struct capture {
+   const uint8_t *data; /*!< Mapped capture file. */
+   size_t size; /*!< Size of the capture file. */
+   size_t offset; /*!< Offset of the next packet record or block. */
+   size_t released; /*!< Offset up to which the read data were released. */
+   int swapped; /*!< Flag of capture file written in different byte order. */
+   int ng; /*!< Flag of pcapng file. */
+   uint32_t ifaces_cnt; /*!< Number of interfaces in the current section. */
+   uint32_t links[CAPTURE_IFACES]; /*!< Link layer types of interfaces. */
+   uint64_t units[CAPTURE_IFACES]; /*!< Timestamp units per second of interfaces. */
+   time_t time; /*!< Timestamp of the last read packet. */
+   uint64_t packets_cnt; /*!< Number of read packets. */
+   uint64_t skipped_cnt; /*!< Number of packets skipped as not IPv4. */
+} capture_t;
+
+/*!
+ * \brief Packet structure.
+ * IPv4 packet decoded from the capture with its transport header fields,
+ * addresses are kept in network byte order.
+ */
+typedef struct packet {
+   time_t time; /*!< Timestamp of the packet in seconds. */
+   uint32_t usec; /*!< Microseconds of the timestamp. */
+   in_addr_t src_ip; /*!< Source IP address. */
+   in_addr_t dst_ip; /*!< Destination IP address. */
+   uint16_t src_port; /*!< Source port. */
+   uint16_t dst_port; /*!< Destination port. */
+   uint8_t protocol; /*!< Used protocol. */
+   uint8_t tcp_flags; /*!< TCP flags. */
+   uint32_t length; /*!< Total length of IPv4 packet. */
+   const uint8_t *payload; /*!< Captured payload behind the transport header. */
+   uint32_t payload_len; /*!< Captured length of the payload. */
+} packet_t;
+
+/*!
+ * \brief Checking capture function.
+ * Function to recognize a pcap or pcapng file by its magic number in either byte order.
+ * \param[in] data Pointer to the beginning of the file.
+ * \param[in] size Size of the file.
+ * \return EXIT_SUCCESS if the file is a capture file, otherwise EXIT_FAILURE.
+ */
+int capture_check(const char *data, size_t size);
+
+/*!
+ * \brief Allocating capture function.
+ * Function to allocate capture reader over a mapped file, global header of pcap
+ * file is validated and link layer type checked, pcapng blocks are read lazily.
+ * \param[in] data Pointer to the beginning of the file.
+ * \param[in] size Size of the file.
+ * \return Pointer to newly created capture reader, otherwise NULL.
+ */
+capture_t *create_capture(const char *data, size_t size);
+
+/*!
+ * \brief Deallocating capture function.
+ * Function to free capture reader, the mapped file is left untouched.
+ * \param[in] capture Pointer to existing capture reader.
+ */
+void free_capture(capture_t *capture);
+
+/*!
+ * \brief Decoding packet function.
+ * Function to decode IPv4 header and the transport header behind it from
+ * captured link layer frame. Fragments without transport header have zero ports.
+ * \param[out] packet Pointer to packet structure to be filled.
+ * \param[in] frame Pointer to captured frame.
+ * \param[in] len Captured length of the frame.
+ * \param[in] link Link layer type of the frame.
+ * \return EXIT_SUCCESS if the frame carries IPv4 packet, otherwise EXIT_FAILURE.
+ */
+int decode_packet(packet_t *packet, const uint8_t *frame, uint32_t len, uint32_t link);
+
+/*!
+ * \brief Reading pcapng block function.
+ * Function to read pcapng blocks until the next packet, section headers and
+ * interface descriptions update the state of the reader.
+ * \param[in] capture Pointer to existing capture reader.
+ * \param[out] frame Pointer to captured frame.
+ * \param[out] len Captured length of the frame.
+ * \param[out] iface Interface of the frame.
+ * \param[out] ts Timestamp of the frame in units of the interface.
+ * \return 1 if a packet block has been read, 0 at the end of the capture.
+ */
+int read_block(capture_t *capture, const uint8_t **frame, uint32_t *len, uint32_t *iface, uint64_t *ts);
+
+/*!
+ * \brief Reading packet function.
+ * Function to read the next IPv4 packet from the capture, other packets are skipped.
+ * Memory of the mapped file already read is released regularly, so even large
+ * captures are read with bounded memory.
+ * \param[in] capture Pointer to existing capture reader.
+ * \param[out] packet Pointer to packet structure to be filled.
+ * \return 1 if a packet has been read, 0 at the end of the capture.
+ */
+int read_packet(capture_t *capture, packet_t *packet);
+
+#endif
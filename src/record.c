@@ -0,0 +1,171 @@
+/*!
+ * \file record.c
+ * \brief Binary flow records library.
+ * \author Jan Neuzil <neuzija1@fit.cvut.cz>
+ * \date 2014
+ */
+/*
+ * Copyright (C) 2014 ISEP
+ */
+
+#include <stddef.h>
+
+#include "record.h"
+
+void record_header(record_header_t *header)
+{
+   record_field_t fields[FIELDS] = {
+      {FIELD_DST_IP, sizeof(uint32_t), offsetof(record_t, dst_ip)},
+      {FIELD_SRC_IP, sizeof(uint32_t), offsetof(record_t, src_ip)},
+      {FIELD_DST_PORT, sizeof(uint16_t), offsetof(record_t, dst_port)},
+      {FIELD_SRC_PORT, sizeof(uint16_t), offsetof(record_t, src_port)},
+      {FIELD_PROTOCOL, sizeof(uint8_t), offsetof(record_t, protocol)},
+      {FIELD_TIME_FIRST, sizeof(uint32_t), offsetof(record_t, time_first)},
+      {FIELD_TIME_LAST, sizeof(uint32_t), offsetof(record_t, time_last)},
+      {FIELD_BYTES, sizeof(uint64_t), offsetof(record_t, bytes)},
+      {FIELD_PACKETS, sizeof(uint32_t), offsetof(record_t, packets)},
+      {FIELD_SYN_FLAG, sizeof(uint8_t), offsetof(record_t, syn_flag)}
+   };
+
+   memset(header, 0, sizeof(record_header_t));
+   memcpy(header->magic, RECORD_MAGIC, RECORD_MAGIC_LEN);
+   header->version = RECORD_VERSION;
+   header->header_size = sizeof(record_header_t);
+   header->record_size = sizeof(record_t);
+   header->fields_cnt = FIELDS - 1;
+   header->byte_order = RECORD_ORDER;
+   header->records_cnt = 0;
+   header->time_first = UINT64_MAX;
+   header->time_last = 0;
+   memcpy(header->fields, fields, sizeof(fields));
+}
+
+int record_check(const record_header_t *header, size_t size)
+{
+   record_header_t tmp;
+
+   if (size < sizeof(record_header_t) || memcmp(header->magic, RECORD_MAGIC, RECORD_MAGIC_LEN) != 0) {
+      fprintf(stderr, "%sGiven file is not a binary flow records file.\n", ERROR);
+      return EXIT_FAILURE;
+   }
+   if (header->byte_order != RECORD_ORDER) {
+      fprintf(stderr, "%sBinary flow records file has different byte order.\n", ERROR);
+      return EXIT_FAILURE;
+   }
+   if (header->version != RECORD_VERSION) {
+      fprintf(stderr, "%sUnsupported version %u of binary flow records file.\n", ERROR, header->version);
+      return EXIT_FAILURE;
+   }
+
+   // Comparing layout of the records with the current one.
+   record_header(&tmp);
+   if (header->header_size != tmp.header_size || header->record_size != tmp.record_size ||
+       header->fields_cnt != tmp.fields_cnt || memcmp(header->fields, tmp.fields, sizeof(tmp.fields)) != 0) {
+      fprintf(stderr, "%sUnsupported layout of binary flow records file.\n", ERROR);
+      return EXIT_FAILURE;
+   }
+
+   if ((size - header->header_size) / header->record_size != header->records_cnt) {
+      fprintf(stderr, "%sBinary flow records file is truncated or not properly closed.\n", WARNING);
+   }
+   return EXIT_SUCCESS;
+}
+
+void record_pack(record_t *record, const flow_t *flow)
+{
+   memset(record, 0, sizeof(record_t));
+   record->bytes = flow->bytes;
+   record->dst_ip = flow->dst_ip;
+   record->src_ip = flow->src_ip;
+   record->time_first = flow->time_first;
+   record->time_last = flow->time_last;
+   record->packets = flow->packets;
+   record->dst_port = flow->dst_port;
+   record->src_port = flow->src_port;
+   record->protocol = flow->protocol;
+   record->syn_flag = flow->syn_flag;
+}
+
+void record_unpack(flow_t *flow, const record_t *record)
+{
+   flow->dst_ip = record->dst_ip;
+   flow->src_ip = record->src_ip;
+   flow->dst_port = record->dst_port;
+   flow->src_port = record->src_port;
+   flow->protocol = record->protocol;
+   flow->time_first = record->time_first;
+   flow->time_last = record->time_last;
+   flow->bytes = record->bytes;
+   flow->packets = record->packets;
+   flow->syn_flag = record->syn_flag;
+}
+
+writer_t *create_writer(const char *path)
+{
+   writer_t *writer;
+
+   writer = (writer_t *) calloc(1, sizeof(writer_t));
+   if (writer == NULL) {
+      fprintf(stderr, "%sNot enough memory for writer structure.\n", ERROR);
+      return NULL;
+   }
+
+   writer->file = fopen(path, "wb");
+   if (writer->file == NULL) {
+      fprintf(stderr, "%sCannot create given binary file.\n", ERROR);
+      free(writer);
+      return NULL;
+   }
+   setvbuf(writer->file, NULL, _IOFBF, RECORD_BUFFER);
+
+   // Writing empty header to be rewritten when the file is closed.
+   record_header(&(writer->header));
+   if (fwrite(&(writer->header), sizeof(record_header_t), 1, writer->file) != 1) {
+      fprintf(stderr, "%sCannot write header of binary file.\n", ERROR);
+      fclose(writer->file);
+      free(writer);
+      return NULL;
+   }
+   return writer;
+}
+
+int write_record(writer_t *writer, const flow_t *flow)
+{
+   record_t record;
+
+   record_pack(&record, flow);
+   if (fwrite(&record, sizeof(record_t), 1, writer->file) != 1) {
+      fprintf(stderr, "%sCannot write flow record into binary file.\n", ERROR);
+      return EXIT_FAILURE;
+   }
+
+   // Updating the time range of stored flows.
+   writer->header.records_cnt ++;
+   if (record.time_first < writer->header.time_first) {
+      writer->header.time_first = record.time_first;
+   }
+   if (record.time_last > writer->header.time_last) {
+      writer->header.time_last = record.time_last;
+   }
+   return EXIT_SUCCESS;
+}
+
+int free_writer(writer_t *writer)
+{
+   int ret;
+
+   ret = EXIT_SUCCESS;
+   if (writer->header.records_cnt == 0) {
+      writer->header.time_first = 0;
+   }
+   if (fseek(writer->file, 0, SEEK_SET) != 0 || fwrite(&(writer->header), sizeof(record_header_t), 1, writer->file) != 1) {
+      fprintf(stderr, "%sCannot write header of binary file.\n", ERROR);
+      ret = EXIT_FAILURE;
+   }
+   if (fclose(writer->file) != 0) {
+      fprintf(stderr, "%sCannot close binary file.\n", ERROR);
+      ret = EXIT_FAILURE;
+   }
+   free(writer);
+   return ret;
+}
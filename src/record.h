@@ -0,0 +1,144 @@
+/*!
+ * \file record.h
+ * \brief Header file to binary flow records library.
+ * \author Jan Neuzil <neuzija1@fit.cvut.cz>
+ * \date 2014
+ */
+/*
+ * Copyright (C) 2014 ISEP
+ */
+
+#ifndef _RECORD_
+#define _RECORD_
+
+#include "main.h"
+
+/*!
+ * \name Binary format values.
+ * Defines macros used by binary flow records file.
+ * \{ */
+#define RECORD_MAGIC "DDOSFLOW" /*!< Magic string at the beginning of a binary file. */
+#define RECORD_MAGIC_LEN 8 /*!< Length of the magic string. */
+#define RECORD_VERSION 1 /*!< Version of the binary format. */
+#define RECORD_ORDER 0x01020304 /*!< Byte order mark of the binary file. */
+#define RECORD_BUFFER 1048576 /*!< Size of a buffer for writing binary file. */
+/*! \} */
+
+/*!
+ * \brief Field descriptor structure.
+ * Structure describing position and size of a flow field in a binary record.
+ */
+typedef struct record_field {
+   uint8_t field; /*!< Field identifier from flow field enumeration. */
+   uint8_t size; /*!< Size of the field in bytes. */
+   uint16_t offset; /*!< Offset of the field in the record. */
+} record_field_t;
+
+/*!
+ * \brief Binary file header structure.
+ * Header at the beginning of binary file describing the layout of records
+ * and the time range of stored flows.
+ */
+typedef struct record_header {
+   char magic[RECORD_MAGIC_LEN]; /*!< Magic string to identify binary file. */
+   uint16_t version; /*!< Version of the binary format. */
+   uint16_t header_size; /*!< Size of the header, records start behind it. */
+   uint16_t record_size; /*!< Size of a single record. */
+   uint16_t fields_cnt; /*!< Number of used field descriptors. */
+   uint32_t byte_order; /*!< Byte order mark to detect different endianness. */
+   uint32_t reserved; /*!< Reserved for future use. */
+   uint64_t records_cnt; /*!< Number of records stored in the file. */
+   uint64_t time_first; /*!< The lowest timestamp of the first packet. */
+   uint64_t time_last; /*!< The highest timestamp of the last packet. */
+   record_field_t fields[FIELDS]; /*!< Layout of fields in a record. */
+   uint8_t padding[4]; /*!< Padding to align records. */
+} record_header_t;
+
+/*!
+ * \brief Binary record structure.
+ * Packed flow record with explicit padding, stored in host byte order
+ * except for IP addresses which are kept in network byte order.
+ */
+typedef struct record {
+   uint64_t bytes; /*!< Number of transmitted bytes. */
+   uint32_t dst_ip; /*!< Destination IP address. */
+   uint32_t src_ip; /*!< Source IP address. */
+   uint32_t time_first; /*!< Timestamp of the first packet. */
+   uint32_t time_last; /*!< Timestamp of the last packet. */
+   uint32_t packets; /*!< Number of transmitted packets. */
+   uint16_t dst_port; /*!< Destination port. */
+   uint16_t src_port; /*!< Source port. */
+   uint8_t protocol; /*!< Used protocol. */
+   uint8_t syn_flag; /*!< SYN flag. */
+   uint8_t padding[6]; /*!< Padding to align records. */
+} record_t;
+
+/*!
+ * \brief Binary writer structure.
+ * Structure of opened binary file with the header updated by every record.
+ */
+typedef struct writer {
+   FILE *file; /*!< Opened binary file. */
+   record_header_t header; /*!< Header to be written when the file is closed. */
+} writer_t;
+
+/*!
+ * \brief Header initialization.
+ * Function to initialize header of an empty binary file with the layout
+ * of current record structure.
+ * \param[out] header Pointer to header structure.
+ */
+void record_header(record_header_t *header);
+
+/*!
+ * \brief Header validation.
+ * Function to check whether the header belongs to a binary file of supported
+ * version and layout and whether the file contains all records.
+ * \param[in] header Pointer to header at the beginning of the file.
+ * \param[in] size Size of the file in bytes.
+ * \return EXIT_SUCCESS on success, otherwise EXIT_FAILURE.
+ */
+int record_check(const record_header_t *header, size_t size);
+
+/*!
+ * \brief Packing function.
+ * Function to convert flow record structure into binary record.
+ * \param[out] record Pointer to binary record.
+ * \param[in] flow Pointer to flow record structure.
+ */
+void record_pack(record_t *record, const flow_t *flow);
+
+/*!
+ * \brief Unpacking function.
+ * Function to convert binary record into flow record structure.
+ * \param[out] flow Pointer to flow record structure.
+ * \param[in] record Pointer to binary record.
+ */
+void record_unpack(flow_t *flow, const record_t *record);
+
+/*!
+ * \brief Allocating writer function.
+ * Function to create binary file and return a pointer to writer structure.
+ * \param[in] path Path of the binary file to be created.
+ * \return Pointer to newly created writer, otherwise NULL.
+ */
+writer_t *create_writer(const char *path);
+
+/*!
+ * \brief Writing function.
+ * Function to append flow record into binary file.
+ * \param[in] writer Pointer to existing writer structure.
+ * \param[in] flow Pointer to flow record structure.
+ * \return EXIT_SUCCESS on success, otherwise EXIT_FAILURE.
+ */
+int write_record(writer_t *writer, const flow_t *flow);
+
+/*!
+ * \brief Deallocating writer function.
+ * Function to write final header and close binary file.
+ * \param[in] writer Pointer to existing writer structure.
+ * \return EXIT_SUCCESS on success, otherwise EXIT_FAILURE.
+ */
+int free_writer(writer_t *writer);
+
+#endif /* _RECORD_ */
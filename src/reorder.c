@@ -0,0 +1,105 @@
+/*!
+ * \file reorder.c
+ * \brief Reorder buffer library.
+ * \author Jan Neuzil <neuzija1@fit.cvut.cz>
+ * \date 2014
+ */
+/*
+ * Copyright (C) 2014 ISEP
+ */
+
+#include "reorder.h"
+
+/*!
+ * \brief Comparing macro.
+ * Order of two heap entries by timestamp and arrival.
+ */
+#define before(x, y) ((x)->flow.time_first < (y)->flow.time_first || ((x)->flow.time_first == (y)->flow.time_first && (x)->seq < (y)->seq))
+
+reorder_t *create_reorder(int window, uint32_t size)
+{
+   reorder_t *reorder;
+
+   reorder = (reorder_t *) calloc(1, sizeof(reorder_t));
+   if (reorder == NULL) {
+      fprintf(stderr, "%sNot enough memory for reorder buffer.\n", ERROR);
+      return NULL;
+   }
+   reorder->window = window;
+   reorder->entries_cnt = 0;
+   reorder->entries_max = size;
+   reorder->time_max = 0;
+   reorder->time_released = 0;
+
+   reorder->entries = (entry_t *) calloc(size, sizeof(entry_t));
+   if (reorder->entries == NULL) {
+      fprintf(stderr, "%sNot enough memory for reorder buffer.\n", ERROR);
+      free(reorder);
+      return NULL;
+   }
+   return reorder;
+}
+
+void free_reorder(reorder_t *reorder)
+{
+   if (reorder != NULL) {
+      free(reorder->entries);
+      free(reorder);
+   }
+}
+
+void push_reorder(reorder_t *reorder, const flow_t *flow)
+{
+   uint32_t i, parent;
+   entry_t entry;
+
+   entry.seq = reorder->seq ++;
+   entry.flow = *flow;
+
+   // Sifting the new entry up from the last leaf.
+   i = reorder->entries_cnt ++;
+   while (i > 0) {
+      parent = (i - 1) / 2;
+      if (!before(&entry, &(reorder->entries[parent]))) {
+         break;
+      }
+      reorder->entries[i] = reorder->entries[parent];
+      i = parent;
+   }
+   reorder->entries[i] = entry;
+}
+
+void pop_reorder(reorder_t *reorder, flow_t *flow)
+{
+   uint32_t child, i;
+   entry_t *last;
+
+   *flow = reorder->entries[0].flow;
+   last = &(reorder->entries[-- reorder->entries_cnt]);
+
+   // Sifting the last entry down from the root.
+   i = 0;
+   while ((child = 2 * i + 1) < reorder->entries_cnt) {
+      if (child + 1 < reorder->entries_cnt && before(&(reorder->entries[child + 1]), &(reorder->entries[child]))) {
+         child ++;
+      }
+      if (!before(&(reorder->entries[child]), last)) {
+         break;
+      }
+      reorder->entries[i] = reorder->entries[child];
+      i = child;
+   }
+   reorder->entries[i] = *last;
+   reorder->time_released = flow->time_first;
+}
+
+int ready_reorder(reorder_t *reorder, int flush)
+{
+   if (reorder->entries_cnt == 0) {
+      return 0;
+   }
+   if (flush != 0) {
+      return 1;
+   }
+   return (reorder->entries[0].flow.time_first + reorder->window <= reorder->time_max);
+}
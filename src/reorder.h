@@ -0,0 +1,87 @@
+/*!
+ * \file reorder.h
+ * \brief Header file to reorder buffer library.
+ * \author Jan Neuzil <neuzija1@fit.cvut.cz>
+ * \date 2014
+ */
+/*
+ * Copyright (C) 2014 ISEP
+ */
+
+#ifndef _REORDER_
+#define _REORDER_
+
+#include "main.h"
+
+/*!
+ * \brief Reorder entry structure.
+ * Flow record buffered in the heap with its arrival sequence number to keep
+ * the order of records with the same timestamp.
+ */
+typedef struct entry {
+   uint64_t seq; /*!< Arrival sequence number. */
+   flow_t flow; /*!< Buffered flow record. */
+} entry_t;
+
+/*!
+ * \brief Reorder buffer structure.
+ * Bounded min-heap of flow records keyed on the timestamp of the first packet
+ * holding the records until no earlier record can arrive within the window.
+ */
+typedef struct reorder {
+   int window; /*!< Reorder window in seconds. */
+   uint32_t entries_cnt; /*!< Number of buffered flow records. */
+   uint32_t entries_max; /*!< Maximum number of buffered flow records. */
+   uint64_t seq; /*!< Sequence number of the next flow record. */
+   uint64_t late_cnt; /*!< Number of flow records arrived after a later one. */
+   uint64_t exceeded_cnt; /*!< Number of late flow records which exceeded the window. */
+   time_t time_max; /*!< The highest timestamp of the first packet seen. */
+   time_t time_released; /*!< Timestamp of the last released flow record. */
+   entry_t *entries; /*!< Preallocated heap of buffered flow records. */
+} reorder_t;
+
+/*!
+ * \brief Allocating reorder function.
+ * Function to allocate reorder buffer with preallocated heap, so no allocation
+ * is needed for a flow record.
+ * \param[in] window Reorder window in seconds.
+ * \param[in] size Maximum number of buffered flow records.
+ * \return Pointer to newly created reorder buffer, otherwise NULL.
+ */
+reorder_t *create_reorder(int window, uint32_t size);
+
+/*!
+ * \brief Deallocating reorder function.
+ * Function to free reorder buffer with all buffered flow records.
+ * \param[in] reorder Pointer to existing reorder buffer.
+ */
+void free_reorder(reorder_t *reorder);
+
+/*!
+ * \brief Inserting function.
+ * Function to insert flow record into the heap, the heap must not be full.
+ * \param[in] reorder Pointer to existing reorder buffer.
+ * \param[in] flow Pointer to flow record structure.
+ */
+void push_reorder(reorder_t *reorder, const flow_t *flow);
+
+/*!
+ * \brief Removing function.
+ * Function to remove the earliest flow record from the heap, the heap must
+ * not be empty.
+ * \param[in] reorder Pointer to existing reorder buffer.
+ * \param[out] flow Pointer to flow record structure.
+ */
+void pop_reorder(reorder_t *reorder, flow_t *flow);
+
+/*!
+ * \brief Release function.
+ * Function to check whether the earliest flow record can be released, either
+ * it is out of the window or all records are being flushed.
+ * \param[in] reorder Pointer to existing reorder buffer.
+ * \param[in] flush Flag to release all buffered flow records.
+ * \return 1 if the record can be released, otherwise 0.
+ */
+int ready_reorder(reorder_t *reorder, int flush);
+
+#endif /* _REORDER_ */
@@ -0,0 +1,206 @@
+/*!
+ * \file shard.c
+ * \brief Sharded aggregation library.
+ * \author Jan Neuzil <neuzija1@fit.cvut.cz>
+ * \date 2014
+ */
+/*
+ * Copyright (C) 2014 ISEP
+ */
+
+#include "shard.h"
+#include "graph.h"
+
+int create_shards(graph_t *graph)
+{
+   int i;
+   shard_t *shard;
+
+   graph->shards = (shard_t *) calloc(graph->params->shards, sizeof(shard_t));
+   if (graph->shards == NULL) {
+      fprintf(stderr, "%sNot enough memory for shards.\n", ERROR);
+      return EXIT_FAILURE;
+   }
+
+   for (i = 0; i < graph->params->shards; i ++) {
+      shard = &(graph->shards[i]);
+      shard->params = *(graph->params);
+      shard->params.shards = 0;
+      shard->graph = create_graph(&(shard->params));
+      if (shard->graph == NULL) {
+         return EXIT_FAILURE;
+      }
+      if (pthread_create(&(shard->thread), NULL, run_shard, shard) != 0) {
+         fprintf(stderr, "%sCannot create shard thread.\n", ERROR);
+         return EXIT_FAILURE;
+      }
+      shard->started = 1;
+   }
+   return EXIT_SUCCESS;
+}
+
+void free_shards(graph_t *graph)
+{
+   int i;
+   shard_t *shard;
+
+   if (graph->shards == NULL) {
+      return;
+   }
+   for (i = 0; i < graph->params->shards; i ++) {
+      shard = &(graph->shards[i]);
+      if (shard->started) {
+         __atomic_store_n(&(shard->stop), 1, __ATOMIC_RELEASE);
+         pthread_join(shard->thread, NULL);
+      }
+      // The graph of a failed shard has been freed by the worker already.
+      if (shard->graph != NULL && !shard->failed) {
+         free_graph(shard->graph);
+      }
+   }
+   free(graph->shards);
+   graph->shards = NULL;
+}
+
+void *run_shard(void *arg)
+{
+   int idle, stop;
+   uint64_t cnt, head;
+   struct timespec sleep;
+   ring_entry_t *entry;
+   graph_t *graph;
+   shard_t *shard;
+
+   shard = (shard_t *) arg;
+   graph = shard->graph;
+   sleep.tv_sec = 0;
+   sleep.tv_nsec = RING_SLEEP;
+   head = shard->ring.head;
+   idle = 0;
+
+   while (1) {
+      // Reading the flag first, so no flow record can be missed when stopping.
+      stop = __atomic_load_n(&(shard->stop), __ATOMIC_ACQUIRE);
+      if (head == __atomic_load_n(&(shard->ring.tail), __ATOMIC_ACQUIRE)) {
+         if (stop) {
+            break;
+         }
+         if (++ idle >= RING_SPIN) {
+            nanosleep(&sleep, NULL);
+         } else {
+            sched_yield();
+         }
+         continue;
+      }
+      idle = 0;
+
+      // Aggregating the flow record in place, the slot is released afterwards.
+      entry = &(shard->ring.entries[head & (RING_SIZE - 1)]);
+      cnt = graph->hosts_cnt;
+      if (get_host(graph, &(entry->flow)) == NULL) {
+         // The graph is freed on failure, the shared pointer is left to the main thread.
+         __atomic_store_n(&(shard->failed), 1, __ATOMIC_RELEASE);
+         break;
+      }
+      if (graph->hosts_cnt > cnt) {
+         graph->hosts[cnt]->seq = entry->seq;
+      }
+      __atomic_store_n(&(shard->ring.head), ++ head, __ATOMIC_RELEASE);
+   }
+   return NULL;
+}
+
+int push_shard(graph_t *graph, flow_t *flow)
+{
+   uint64_t tail;
+   shard_t *shard;
+
+   // Partitioning by the upper bits of the hash, the lower bits index hash tables of shards.
+   shard = &(graph->shards[(hash_host(flow->dst_ip) * graph->params->shards) >> 32]);
+   if (__atomic_load_n(&(shard->failed), __ATOMIC_ACQUIRE)) {
+      fprintf(stderr, "%sShard thread failed, aggregation interrupted.\n", ERROR);
+      return EXIT_FAILURE;
+   }
+
+   // Waiting for a free slot in the ring.
+   tail = shard->ring.tail;
+   while (tail - __atomic_load_n(&(shard->ring.head), __ATOMIC_ACQUIRE) == RING_SIZE) {
+      if (__atomic_load_n(&(shard->failed), __ATOMIC_ACQUIRE)) {
+         fprintf(stderr, "%sShard thread failed, aggregation interrupted.\n", ERROR);
+         return EXIT_FAILURE;
+      }
+      sched_yield();
+   }
+
+   // Shards are idle since merge, when the main graph moves to the next interval.
+   if (shard->graph->interval_last != graph->interval_last) {
+      shard->graph->interval_idx = graph->interval_idx;
+      shard->graph->interval_first = graph->interval_first;
+      shard->graph->interval_last = graph->interval_last;
+      shard->graph->window_cnt = graph->window_cnt;
+   }
+
+   shard->ring.entries[tail & (RING_SIZE - 1)].flow = *flow;
+   shard->ring.entries[tail & (RING_SIZE - 1)].seq = graph->params->flows_cnt;
+   __atomic_store_n(&(shard->ring.tail), tail + 1, __ATOMIC_RELEASE);
+   return EXIT_SUCCESS;
+}
+
+int merge_shards(graph_t *graph)
+{
+   int i, next;
+   host_t *host, **hosts;
+   shard_t *shard;
+
+   // Waiting for all shards to become idle.
+   for (i = 0; i < graph->params->shards; i ++) {
+      shard = &(graph->shards[i]);
+      while (__atomic_load_n(&(shard->ring.head), __ATOMIC_ACQUIRE) != shard->ring.tail) {
+         if (__atomic_load_n(&(shard->failed), __ATOMIC_ACQUIRE)) {
+            fprintf(stderr, "%sShard thread failed, aggregation interrupted.\n", ERROR);
+            return EXIT_FAILURE;
+         }
+         sched_yield();
+      }
+   }
+
+   // Merging new hosts of shards, each shard holds them in order of their sequence numbers.
+   while (1) {
+      next = -1;
+      for (i = 0; i < graph->params->shards; i ++) {
+         shard = &(graph->shards[i]);
+         if (shard->merged < shard->graph->hosts_cnt && (next < 0 ||
+             shard->graph->hosts[shard->merged]->seq < graph->shards[next].graph->hosts[graph->shards[next].merged]->seq)) {
+            next = i;
+         }
+      }
+      if (next < 0) {
+         break;
+      }
+      shard = &(graph->shards[next]);
+      host = shard->graph->hosts[shard->merged];
+      hosts = add_host(graph->hosts, host, &(graph->hosts_cnt), &(graph->hosts_max));
+      if (hosts == NULL) {
+         return EXIT_FAILURE;
+      }
+      graph->hosts = hosts;
+      shard->merged ++;
+   }
+   return EXIT_SUCCESS;
+}
+
+void reset_shards(graph_t *graph)
+{
+   int i;
+   shard_t *shard;
+
+   for (i = 0; i < graph->params->shards; i ++) {
+      shard = &(graph->shards[i]);
+      if (__atomic_load_n(&(shard->failed), __ATOMIC_ACQUIRE)) {
+         continue;
+      }
+      shard->graph->interval_idx = graph->interval_idx;
+      shard->graph->window_cnt = graph->window_cnt;
+      reset_graph(shard->graph);
+   }
+}
@@ -0,0 +1,120 @@
+/*!
+ * \file shard.h
+ * \brief Header file to sharded aggregation library.
+ * \author Jan Neuzil <neuzija1@fit.cvut.cz>
+ * \date 2014
+ */
+/*
+ * Copyright (C) 2014 ISEP
+ */
+
+#ifndef _SHARD_
+#define _SHARD_
+
+#include "main.h"
+
+/*!
+ * \name Shard values.
+ * Defines macros used by ring buffers feeding shards with flow records.
+ * \{ */
+#define RING_SIZE 4096 /*!< Number of flow records in a ring buffer, a power of two. */
+#define RING_SPIN 1024 /*!< Number of polls of an empty ring buffer before the worker sleeps. */
+#define RING_SLEEP 50000 /*!< Sleep of a worker waiting for flow records in nanoseconds. */
+#define CACHE_LINE 64 /*!< Size of cache line separating indices of the producer and the consumer. */
+/*! \} */
+
+/*!
+ * \brief Ring entry structure.
+ * Flow record passed to a shard with its sequence number.
+ */
+typedef struct ring_entry {
+   flow_t flow; /*!< Flow record. */
+   uint64_t seq; /*!< Sequence number of the flow record. */
+} ring_entry_t;
+
+/*!
+ * \brief Ring buffer structure.
+ * Lock-free single producer single consumer queue of flow records. The consumer
+ * moves the head only after the entry has been processed, so the ring is empty
+ * when the shard is idle and all its hosts are up to date.
+ */
+typedef struct ring {
+   uint64_t head; /*!< Number of entries processed by the consumer. */
+   uint8_t head_pad[CACHE_LINE - sizeof(uint64_t)]; /*!< Padding of the head to its own cache line. */
+   uint64_t tail; /*!< Number of entries written by the producer. */
+   uint8_t tail_pad[CACHE_LINE - sizeof(uint64_t)]; /*!< Padding of the tail to its own cache line. */
+   ring_entry_t entries[RING_SIZE]; /*!< Entries indexed by position modulo the size. */
+} ring_t;
+
+/*!
+ * \brief Shard structure.
+ * Part of hosts partitioned by hash of destination IP address, aggregated
+ * by a worker thread into its own graph with own host index and SYN matrix.
+ */
+typedef struct shard {
+   pthread_t thread; /*!< Worker thread of the shard. */
+   int started; /*!< Flag of running worker thread. */
+   int stop; /*!< Flag to stop the worker when the ring is empty. */
+   int failed; /*!< Flag of a failure in the worker, the graph of the shard is freed but the pointer is kept. */
+   uint64_t merged; /*!< Number of hosts of the shard already merged into the main graph. */
+   params_t params; /*!< Copy of parameters for the graph of the shard. */
+   graph_t *graph; /*!< Graph of hosts of the shard. */
+   ring_t ring; /*!< Ring buffer of flow records to be aggregated. */
+} shard_t;
+
+/*!
+ * \brief Allocating shards function.
+ * Function to allocate graphs of all shards and start their worker threads.
+ * \param[in] graph Pointer to existing main graph structure.
+ * \return EXIT_SUCCESS on success, otherwise EXIT_FAILURE.
+ */
+int create_shards(graph_t *graph);
+
+/*!
+ * \brief Deallocating shards function.
+ * Function to stop worker threads after they process remaining flow records
+ * and free graphs of all shards with their hosts.
+ * \param[in] graph Pointer to existing main graph structure.
+ */
+void free_shards(graph_t *graph);
+
+/*!
+ * \brief Worker function.
+ * Function run by worker thread to add flow records from the ring buffer
+ * to the graph of the shard.
+ * \param[in] arg Pointer to the shard structure.
+ * \return Always NULL.
+ */
+void *run_shard(void *arg);
+
+/*!
+ * \brief Dispatching function.
+ * Function to pass flow record to the shard of its destination IP address,
+ * it fails if the worker has failed and waits while the ring buffer is full. Interval boundaries
+ * are copied to the idle shard when the main graph has moved to the next interval.
+ * \param[in] graph Pointer to existing main graph structure.
+ * \param[in] flow Pointer to flow record structure.
+ * \return EXIT_SUCCESS on success, otherwise EXIT_FAILURE.
+ */
+int push_shard(graph_t *graph, flow_t *flow);
+
+/*!
+ * \brief Merging shards function.
+ * Function to wait until all shards process their flow records and append
+ * hosts created since the last merge to the array of hosts of the main graph
+ * in order of their first flow records, so the hosts are clustered in the same
+ * order as by a single graph.
+ * \param[in] graph Pointer to existing main graph structure.
+ * \return EXIT_SUCCESS on success, otherwise EXIT_FAILURE.
+ */
+int merge_shards(graph_t *graph);
+
+/*!
+ * \brief Reseting shards function.
+ * Function to reset graphs of all idle shards at the end of the interval
+ * together with the main graph, failed shards are skipped.
+ * \param[in] graph Pointer to existing main graph structure.
+ */
+void reset_shards(graph_t *graph);
+
+#endif /* _SHARD_ */
@@ -0,0 +1,229 @@
+/*!
+ * \file simd.c
+ * \brief Vectorized kernels library.
+ * \author Jan Neuzil <neuzija1@fit.cvut.cz>
+ * \date 2014
+ */
+/*
+ * Copyright (C) 2014 ISEP
+ */
+
+#include "simd.h"
+
+#if defined(__x86_64__) || defined(__i386__)
+#include <immintrin.h>
+#endif
+
+scan_t scan_line = scan_scalar;
+distance_t distance = distance_scalar;
+
+void simd_init(void)
+{
+#if defined(__x86_64__) || defined(__i386__)
+   __builtin_cpu_init();
+   if (__builtin_cpu_supports("avx2")) {
+      scan_line = scan_avx2;
+   } else if (__builtin_cpu_supports("sse2")) {
+      scan_line = scan_sse2;
+   }
+   if (__builtin_cpu_supports("avx512f") && check_distance(distance_avx512, "AVX-512") == EXIT_SUCCESS) {
+      distance = distance_avx512;
+   } else if (__builtin_cpu_supports("avx2") && __builtin_cpu_supports("fma") && check_distance(distance_avx2, "AVX2") == EXIT_SUCCESS) {
+      distance = distance_avx2;
+   } else if (__builtin_cpu_supports("sse2") && check_distance(distance_sse2, "SSE2") == EXIT_SUCCESS) {
+      distance = distance_sse2;
+   }
+#endif
+}
+
+int check_distance(distance_t kernel, const char *name)
+{
+   int i, n;
+   double x[DISTANCE_CHECK], y[DISTANCE_CHECK], a, b;
+
+   for (i = 0; i < DISTANCE_CHECK; i ++) {
+      x[i] = i * 1.5 + 0.25;
+      y[i] = (DISTANCE_CHECK - i) * 0.75;
+   }
+
+   // Placing vectors at the end of arrays, so the last dimensions are always at the boundary.
+   for (n = 0; n <= DISTANCE_CHECK; n ++) {
+      a = kernel(x + DISTANCE_CHECK - n, y + DISTANCE_CHECK - n, n);
+      b = distance_scalar(x + DISTANCE_CHECK - n, y + DISTANCE_CHECK - n, n);
+      if (fabs(a - b) > DISTANCE_TOLERANCE * (b + 1.0)) {
+         fprintf(stderr, "%s%s distance kernel differs for %d dimensions, kernel skipped.\n", WARNING, name, n);
+         return EXIT_FAILURE;
+      }
+   }
+   return EXIT_SUCCESS;
+}
+
+const char *scan_tail(const char *line, const char *tmp, const char *end, uint32_t *delims, int n, int *cnt)
+{
+   for (; tmp < end; tmp ++) {
+      if (*tmp == '\n') {
+         break;
+      }
+      if (*tmp == DELIMITER && n < FIELDS) {
+         delims[n ++] = tmp - line;
+      }
+   }
+   *cnt = n;
+   return tmp;
+}
+
+const char *scan_scalar(const char *line, const char *end, uint32_t *delims, int *cnt)
+{
+   return scan_tail(line, line, end, delims, 0, cnt);
+}
+
+double distance_scalar(const double *x, const double *y, int n)
+{
+   int i;
+   double d, sum;
+
+   sum = 0.0;
+   for (i = 0; i < n; i ++) {
+      d = x[i] - y[i];
+      sum += square(d);
+   }
+   return sum;
+}
+
+#if defined(__x86_64__) || defined(__i386__)
+__attribute__((target("sse2")))
+const char *scan_sse2(const char *line, const char *end, uint32_t *delims, int *cnt)
+{
+   int n;
+   uint32_t lf, sp;
+   const char *tmp;
+   __m128i newline, space, x;
+
+   n = 0;
+   newline = _mm_set1_epi8('\n');
+   space = _mm_set1_epi8(DELIMITER);
+
+   for (tmp = line; end - tmp >= 16; tmp += 16) {
+      x = _mm_loadu_si128((const __m128i *) tmp);
+      lf = _mm_movemask_epi8(_mm_cmpeq_epi8(x, newline));
+      sp = _mm_movemask_epi8(_mm_cmpeq_epi8(x, space));
+
+      // Ignoring delimiters behind the end of line.
+      if (lf != 0) {
+         sp &= (lf & -lf) - 1;
+      }
+      while (sp != 0 && n < FIELDS) {
+         delims[n ++] = (tmp - line) + __builtin_ctz(sp);
+         sp &= sp - 1;
+      }
+      if (lf != 0) {
+         *cnt = n;
+         return tmp + __builtin_ctz(lf);
+      }
+   }
+
+   // Scanning the rest of data shorter than a vector.
+   return scan_tail(line, tmp, end, delims, n, cnt);
+}
+
+__attribute__((target("avx2")))
+const char *scan_avx2(const char *line, const char *end, uint32_t *delims, int *cnt)
+{
+   int n;
+   uint32_t lf, sp;
+   const char *tmp;
+   __m256i newline, space, x;
+
+   n = 0;
+   newline = _mm256_set1_epi8('\n');
+   space = _mm256_set1_epi8(DELIMITER);
+
+   for (tmp = line; end - tmp >= 32; tmp += 32) {
+      x = _mm256_loadu_si256((const __m256i *) tmp);
+      lf = _mm256_movemask_epi8(_mm256_cmpeq_epi8(x, newline));
+      sp = _mm256_movemask_epi8(_mm256_cmpeq_epi8(x, space));
+
+      // Ignoring delimiters behind the end of line.
+      if (lf != 0) {
+         sp &= (lf & -lf) - 1;
+      }
+      while (sp != 0 && n < FIELDS) {
+         delims[n ++] = (tmp - line) + __builtin_ctz(sp);
+         sp &= sp - 1;
+      }
+      if (lf != 0) {
+         *cnt = n;
+         return tmp + __builtin_ctz(lf);
+      }
+   }
+
+   // Scanning the rest of data shorter than a vector.
+   return scan_tail(line, tmp, end, delims, n, cnt);
+}
+
+__attribute__((target("sse2")))
+double distance_sse2(const double *x, const double *y, int n)
+{
+   int i;
+   double sum[2];
+   __m128d acc, d;
+
+   acc = _mm_setzero_pd();
+   for (i = 0; i + 2 <= n; i += 2) {
+      d = _mm_sub_pd(_mm_loadu_pd(x + i), _mm_loadu_pd(y + i));
+      acc = _mm_add_pd(acc, _mm_mul_pd(d, d));
+   }
+   _mm_storeu_pd(sum, acc);
+
+   // Adding the last odd dimension.
+   return sum[0] + sum[1] + distance_scalar(x + i, y + i, n - i);
+}
+
+__attribute__((target("avx2,fma")))
+double distance_avx2(const double *x, const double *y, int n)
+{
+   int i;
+   double sum[4];
+   __m256d acc0, acc1, d0, d1;
+
+   acc0 = _mm256_setzero_pd();
+   acc1 = _mm256_setzero_pd();
+   for (i = 0; i + 8 <= n; i += 8) {
+      d0 = _mm256_sub_pd(_mm256_loadu_pd(x + i), _mm256_loadu_pd(y + i));
+      d1 = _mm256_sub_pd(_mm256_loadu_pd(x + i + 4), _mm256_loadu_pd(y + i + 4));
+      acc0 = _mm256_fmadd_pd(d0, d0, acc0);
+      acc1 = _mm256_fmadd_pd(d1, d1, acc1);
+   }
+   if (i + 4 <= n) {
+      d0 = _mm256_sub_pd(_mm256_loadu_pd(x + i), _mm256_loadu_pd(y + i));
+      acc0 = _mm256_fmadd_pd(d0, d0, acc0);
+      i += 4;
+   }
+   _mm256_storeu_pd(sum, _mm256_add_pd(acc0, acc1));
+
+   // Adding the last dimensions which do not fill a whole vector.
+   return (sum[0] + sum[1]) + (sum[2] + sum[3]) + distance_scalar(x + i, y + i, n - i);
+}
+
+__attribute__((target("avx512f")))
+double distance_avx512(const double *x, const double *y, int n)
+{
+   int i;
+   __mmask8 mask;
+   __m512d acc, d;
+
+   acc = _mm512_setzero_pd();
+   for (i = 0; i + 8 <= n; i += 8) {
+      d = _mm512_sub_pd(_mm512_loadu_pd(x + i), _mm512_loadu_pd(y + i));
+      acc = _mm512_fmadd_pd(d, d, acc);
+   }
+
+   // Loading the last dimensions by mask, masked lanes are zero in both vectors.
+   if (i < n) {
+      mask = (__mmask8) ((1U << (n - i)) - 1);
+      d = _mm512_sub_pd(_mm512_maskz_loadu_pd(mask, x + i), _mm512_maskz_loadu_pd(mask, y + i));
+      acc = _mm512_fmadd_pd(d, d, acc);
+   }
+   return _mm512_reduce_add_pd(acc);
+}
+#endif
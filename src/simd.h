@@ -0,0 +1,152 @@
+/*!
+ * \file simd.h
+ * \brief Header file to vectorized kernels library.
+ * \author Jan Neuzil <neuzija1@fit.cvut.cz>
+ * \date 2014
+ */
+/*
+ * Copyright (C) 2014 ISEP
+ */
+
+#ifndef _SIMD_
+#define _SIMD_
+
+#include "main.h"
+
+/*!
+ * \name Kernel check values.
+ * Defines macros used by the self-test of distance kernels.
+ * \{ */
+#define DISTANCE_CHECK 17 /*!< Largest number of dimensions compared with the scalar kernel. */
+#define DISTANCE_TOLERANCE 1e-12 /*!< Relative difference from the scalar kernel allowed for rounding. */
+/*! \} */
+
+/*!
+ * \brief Line scanner type.
+ * Function type of a scanner looking for the end of line and positions
+ * of delimiters between the fields of the line.
+ */
+typedef const char *(*scan_t)(const char *line, const char *end, uint32_t *delims, int *cnt);
+
+extern scan_t scan_line; /*!< Line scanner selected for the current processor. */
+
+/*!
+ * \brief Distance kernel type.
+ * Function type of a kernel computing squared Euclidean distance of two
+ * contiguous vectors of SYN packets.
+ */
+typedef double (*distance_t)(const double *x, const double *y, int n);
+
+extern distance_t distance; /*!< Distance kernel selected for the current processor. */
+
+/*!
+ * \brief Initialization function.
+ * Function to select the fastest vectorized kernels supported by the processor,
+ * distance kernels are used only if they pass the self-test.
+ */
+void simd_init(void);
+
+/*!
+ * \brief Checking function.
+ * Function to compare the distance kernel with the scalar kernel for every
+ * number of dimensions up to DISTANCE_CHECK, vectors end at the end of arrays
+ * and are not aligned, so the tails of kernels are checked too.
+ * \param[in] kernel Distance kernel to be checked.
+ * \param[in] name Name of the kernel reported on failure.
+ * \return EXIT_SUCCESS if the kernel gives the same distances, otherwise EXIT_FAILURE.
+ */
+int check_distance(distance_t kernel, const char *name);
+
+/*!
+ * \brief Scanning function.
+ * Function to finish scanning of a line byte by byte, used for the remaining
+ * bytes which do not fill a whole vector.
+ * \param[in] line Pointer to the beginning of the line.
+ * \param[in] tmp Pointer to the first byte to be scanned.
+ * \param[in] end Pointer behind the last byte of the data.
+ * \param[out] delims Array of FIELDS offsets of delimiters within the line.
+ * \param[in] n Number of delimiters already found.
+ * \param[out] cnt Number of found delimiters, at most FIELDS.
+ * \return Pointer to the end of line character, end if not present.
+ */
+const char *scan_tail(const char *line, const char *tmp, const char *end, uint32_t *delims, int n, int *cnt);
+
+/*!
+ * \brief Scanning function.
+ * Scalar reference scanner to find the end of line and delimiters in one pass.
+ * \param[in] line Pointer to the beginning of the line.
+ * \param[in] end Pointer behind the last byte of the data.
+ * \param[out] delims Array of FIELDS offsets of delimiters within the line.
+ * \param[out] cnt Number of found delimiters, at most FIELDS.
+ * \return Pointer to the end of line character, end if not present.
+ */
+const char *scan_scalar(const char *line, const char *end, uint32_t *delims, int *cnt);
+
+/*!
+ * \brief Distance function.
+ * Scalar reference kernel summing squared differences one by one, used by
+ * the self-test of vectorized kernels and on processors without them.
+ * \param[in] x Pointer to the first vector.
+ * \param[in] y Pointer to the second vector.
+ * \param[in] n Number of dimensions.
+ * \return Squared Euclidean distance of the vectors.
+ */
+double distance_scalar(const double *x, const double *y, int n);
+
+#if defined(__x86_64__) || defined(__i386__)
+/*!
+ * \brief Scanning function.
+ * SSE2 scanner comparing 16 bytes at once against the end of line and delimiter.
+ * \param[in] line Pointer to the beginning of the line.
+ * \param[in] end Pointer behind the last byte of the data.
+ * \param[out] delims Array of FIELDS offsets of delimiters within the line.
+ * \param[out] cnt Number of found delimiters, at most FIELDS.
+ * \return Pointer to the end of line character, end if not present.
+ */
+const char *scan_sse2(const char *line, const char *end, uint32_t *delims, int *cnt);
+
+/*!
+ * \brief Scanning function.
+ * AVX2 scanner comparing 32 bytes at once against the end of line and delimiter.
+ * \param[in] line Pointer to the beginning of the line.
+ * \param[in] end Pointer behind the last byte of the data.
+ * \param[out] delims Array of FIELDS offsets of delimiters within the line.
+ * \param[out] cnt Number of found delimiters, at most FIELDS.
+ * \return Pointer to the end of line character, end if not present.
+ */
+const char *scan_avx2(const char *line, const char *end, uint32_t *delims, int *cnt);
+
+/*!
+ * \brief Distance function.
+ * SSE2 kernel summing squared differences of 2 dimensions at once.
+ * \param[in] x Pointer to the first vector.
+ * \param[in] y Pointer to the second vector.
+ * \param[in] n Number of dimensions.
+ * \return Squared Euclidean distance of the vectors.
+ */
+double distance_sse2(const double *x, const double *y, int n);
+
+/*!
+ * \brief Distance function.
+ * AVX2 kernel summing squared differences of 4 dimensions at once with fused
+ * multiply-add into two independent accumulators.
+ * \param[in] x Pointer to the first vector.
+ * \param[in] y Pointer to the second vector.
+ * \param[in] n Number of dimensions.
+ * \return Squared Euclidean distance of the vectors.
+ */
+double distance_avx2(const double *x, const double *y, int n);
+
+/*!
+ * \brief Distance function.
+ * AVX-512 kernel summing squared differences of 8 dimensions at once, the rest
+ * of dimensions is handled by a masked load.
+ * \param[in] x Pointer to the first vector.
+ * \param[in] y Pointer to the second vector.
+ * \param[in] n Number of dimensions.
+ * \return Squared Euclidean distance of the vectors.
+ */
+double distance_avx512(const double *x, const double *y, int n);
+#endif
+
+#endif /* _SIMD_ */